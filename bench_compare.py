@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""
+Compares two `benchmark ... --json <path>` runs and fails on regressions.
+
+usage: bench_compare.py <baseline.json> <current.json> [--threshold 0.10]
+                        [--threshold-for <name prefix>=<fraction> ...] [--fail-on-missing]
+
+A result regresses when it is worse than the baseline by more than the
+threshold: lower for "better": "higher" results, higher for "better":
+"lower" ones. --threshold-for loosens or tightens the threshold for every
+result whose name starts with the prefix, the longest matching prefix wins
+("load/=0.3" for the disk bound numbers, say). Exits with 1 when anything
+regressed, 2 on bad input.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    try:
+        with open(path) as file:
+            data = json.load(file)
+    except (OSError, ValueError) as error:
+        print(f"COULD NOT READ THE RESULTS: {path}: {error}")
+        sys.exit(2)
+
+    # everything main() reads from a result, checked here so bad input exits with 2 and not a traceback
+    try:
+        results = {}
+        for result in data["results"]:
+            name = result["name"]
+            if not isinstance(name, str) or not isinstance(result["unit"], str):
+                raise TypeError("name and unit must be strings")
+            if result["better"] not in ("higher", "lower"):
+                raise ValueError(f"better must be \"higher\" or \"lower\" for {name}")
+            result["value"] = float(result["value"])
+            results[name] = result
+    except (KeyError, TypeError, ValueError, AttributeError) as error:
+        print(f"INVALID RESULTS FILE: {path}: {type(error).__name__}: {error}")
+        sys.exit(2)
+    return data, results
+
+
+def parse_overrides(pairs):
+    overrides = {}
+    for pair in pairs:
+        prefix, separator, fraction = pair.rpartition("=")
+        if not separator or not prefix:
+            print(f"INVALID THRESHOLD OVERRIDE: {pair}")
+            sys.exit(2)
+        try:
+            overrides[prefix] = float(fraction)
+        except ValueError:
+            print(f"INVALID THRESHOLD OVERRIDE: {pair}")
+            sys.exit(2)
+    return overrides
+
+
+def threshold_for(name, default, overrides):
+    best = None
+    for prefix in overrides:
+        if name.startswith(prefix) and (best is None or len(prefix) > len(best)):
+            best = prefix
+    return overrides[best] if best is not None else default
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare two benchmark JSON files.")
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=0.10,
+                        help="allowed slowdown as a fraction of the baseline (default 0.10)")
+    parser.add_argument("--threshold-for", action="append", default=[], metavar="PREFIX=FRACTION",
+                        help="threshold for the results whose name starts with PREFIX")
+    parser.add_argument("--fail-on-missing", action="store_true",
+                        help="also fail when a baseline result is missing from the current run")
+    args = parser.parse_args()
+
+    overrides = parse_overrides(args.threshold_for)
+    baseline_data, baseline = load(args.baseline)
+    current_data, current = load(args.current)
+
+    for field in ("simd", "hardware_threads"):
+        if baseline_data.get(field) != current_data.get(field):
+            print(f"note: {field} differs, {baseline_data.get(field)} -> {current_data.get(field)}")
+
+    regressions = 0
+    missing = 0
+    width = max((len(name) for name in baseline), default=4)
+    for name, base in baseline.items():
+        if name not in current:
+            missing += 1
+            print(f"  {name:<{width}}  missing from the current run")
+            continue
+
+        now = current[name]
+        higher = base["better"] == "higher"
+        if base["value"] <= 0:
+            continue
+
+        # > 0 is better, < 0 worse, as a fraction of the baseline
+        change = (now["value"] - base["value"]) / base["value"]
+        if not higher:
+            change = -change
+
+        limit = threshold_for(name, args.threshold, overrides)
+        status = ""
+        if change < -limit:
+            status = "REGRESSION"
+            regressions += 1
+        elif change > limit:
+            status = "faster"
+        print(f"  {name:<{width}}  {base['value']:>12.4g} -> {now['value']:>12.4g} {base['unit']:<12}"
+              f"{change * 100.0:+7.1f}%  {status}")
+
+    for name in current:
+        if name not in baseline:
+            print(f"  {name:<{width}}  new, {current[name]['value']:.4g} {current[name]['unit']}")
+
+    print(f"{regressions} regressions, {missing} missing, {len(baseline)} compared")
+    if regressions or (missing and args.fail_on_missing):
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
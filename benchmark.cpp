@@ -0,0 +1,1099 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "erosion.hpp"
+#include "fractal.hpp"
+#include "geometry.hpp"
+#include "heightmap.hpp"
+#include "heightmap_file.hpp"
+#include "height_pyramid.hpp"
+#include "height_sampler.hpp"
+#include "height_tiles.hpp"
+#include "job_system.hpp"
+#include "noise.hpp"
+#include "noise_graph.hpp"
+#include "patch_grid.hpp"
+#include "simd.hpp"
+#include "terrain_gen.hpp"
+#include "terrain_raycast.hpp"
+
+/*
+	Standalone benchmark, no window or GL context needed.
+
+	usage: benchmark tiles [size] [max threads]
+	       benchmark noise [samples]
+	       benchmark fbm [size]
+	       benchmark graph [size]
+	       benchmark load [heightmap]
+	       benchmark pyramid [size]
+	       benchmark raycast [size]
+	       benchmark sample [size]
+	       benchmark erosion [size] [max threads]
+	       benchmark thermal [size] [iterations]
+	       benchmark mesh [plane divisions] [heightmap size]
+	       benchmark all
+
+	--json <path> anywhere on the command line also writes the headline
+	numbers of the run to path, bench_compare.py compares two such files.
+*/
+
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsSince(Clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+struct BenchResult {
+	std::string name;
+	double value;
+	std::string unit;
+	bool higherIsBetter;
+};
+
+// every suite records its headline numbers here besides printing them
+static std::vector<BenchResult> recorded;
+
+static void record(const std::string& name, double value, const std::string& unit, bool higherIsBetter) {
+	recorded.push_back({ name, value, unit, higherIsBetter });
+}
+
+// result names out of their parts, "fbm/ridged/octaves 8"
+template<class... Parts>
+static std::string key(const Parts&... parts) {
+	std::ostringstream name;
+	(name << ... << parts);
+	return name.str();
+}
+
+static bool writeJson(const std::string& path, const std::string& suite) {
+	std::ofstream file(path, std::ios::trunc);
+	if (!file) {
+		std::cout << "COULD NOT WRITE THE RESULTS: " << path << std::endl;
+		return false;
+	}
+
+	file.precision(9);
+	file << "{\n"
+		<< "  \"suite\": \"" << suite << "\",\n"
+		<< "  \"simd\": \"" << simdLevelName(detectSimdLevel()) << "\",\n"
+		<< "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n"
+		<< "  \"results\": [";
+	for (size_t i = 0; i < recorded.size(); i++) {
+		const BenchResult& result = recorded[i];
+		// JSON has no inf or nan, a run too short to time reads as 0
+		double value = std::isfinite(result.value) ? result.value : 0.0;
+		file << (i == 0 ? "\n" : ",\n")
+			<< "    { \"name\": \"" << result.name << "\", \"value\": " << value
+			<< ", \"unit\": \"" << result.unit << "\", \"better\": \"" << (result.higherIsBetter ? "higher" : "lower") << "\" }";
+	}
+	file << "\n  ]\n}\n";
+
+	if (!file) {
+		std::cout << "COULD NOT WRITE THE RESULTS: " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// a fixed xorshift stream, so every run works on the same data
+struct XorShift {
+	uint32_t state = 0x12345678u;
+
+	// in [0, 1)
+	float next() {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return (float)(state & 0xFFFFFF) / (float)0x1000000;
+	}
+};
+
+static void benchTiledGeneration(int size, unsigned maxThreads) {
+	PerlinNoise perlin(1337);
+	std::vector<float> heights((size_t)size * size);
+
+	std::cout << "tiled heightmap generation, " << size << "x" << size << '\n';
+
+	double baseline = 0.0;
+	for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+		JobSystem jobs(threads);
+
+		// warm up: page in the output buffer and spin up the workers
+		generateHeightmap(jobs, perlin, heights.data(), size, size, glm::vec2(0.0f), 1.0f / 128.0f);
+
+		Clock::time_point start = Clock::now();
+		generateHeightmap(jobs, perlin, heights.data(), size, size, glm::vec2(0.0f), 1.0f / 128.0f);
+		double ms = millisecondsSince(start);
+
+		if (threads == 1) {
+			baseline = ms;
+		}
+
+		double speedup = baseline / ms;
+		std::cout << "  threads: " << threads
+			<< "  time: " << ms << " ms"
+			<< "  Msamples/s: " << (double)size * size / (ms * 1000.0)
+			<< "  speedup: " << speedup
+			<< "  efficiency: " << speedup / threads * 100.0 << "%\n";
+		record(key("tiles/threads ", threads), (double)size * size / (ms * 1000.0), "Msamples/s", true);
+	}
+}
+
+static void benchNoise(int count) {
+	// whole groups of 8
+	count = std::max(8, count / 8 * 8);
+	PerlinNoise perlin(1337);
+
+	// spread over many lattice cells, the way the octaves of a fractal hit the permutation table
+	XorShift random;
+	std::vector<float> x(count), y(count), out(count), reference(count);
+	for (int i = 0; i < count; i++) {
+		x[i] = random.next() * 4096.0f - 2048.0f;
+		y[i] = random.next() * 4096.0f - 2048.0f;
+	}
+
+	std::cout << "perlin noise, " << count << " samples, single thread\n";
+
+	double ms = 1e30;
+	for (int run = 0; run < 5; run++) {
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < count; i++) {
+			reference[i] = perlin.noise(x[i], y[i]);
+		}
+		ms = std::min(ms, millisecondsSince(start));
+	}
+	std::cout << "  noise()  Msamples/s: " << count / (ms * 1000.0) << '\n';
+	record("noise/noise()", count / (ms * 1000.0), "Msamples/s", true);
+
+	SIMD_LEVEL best = detectSimdLevel();
+	for (int level = SIMD_SCALAR; level <= best; level++) {
+		setSimdLevel((SIMD_LEVEL)level);
+		ms = 1e30;
+		for (int run = 0; run < 5; run++) {
+			Clock::time_point start = Clock::now();
+			for (int i = 0; i < count; i += 8) {
+				perlin.noise8(&x[i], &y[i], &out[i]);
+			}
+			ms = std::min(ms, millisecondsSince(start));
+		}
+
+		float largest = 0.0f;
+		for (int i = 0; i < count; i++) {
+			largest = std::max(largest, std::fabs(out[i] - reference[i]));
+		}
+		std::cout << "  noise8 " << simdLevelName((SIMD_LEVEL)level)
+			<< "  Msamples/s: " << count / (ms * 1000.0)
+			<< "  largest difference to noise(): " << largest << '\n';
+		record(key("noise/noise8 ", simdLevelName((SIMD_LEVEL)level)), count / (ms * 1000.0), "Msamples/s", true);
+	}
+	setSimdLevel(best);
+}
+
+static void benchFractal(int size) {
+	JobSystem jobs;
+	std::vector<float> full((size_t)size * size), early((size_t)size * size);
+	const char* names[] = { "fbm", "ridged", "billow" };
+
+	std::cout << "fractal noise, " << size << "x" << size << ", early-out against R16 quantization\n";
+
+	for (int type = FRACTAL_FBM; type <= FRACTAL_BILLOW; type++) {
+		for (float gain : { 0.5f, 0.35f })
+		for (int octaves : { 8, 12, 16, 20 }) {
+			FractalParams params;
+			params.type = (FRACTAL_TYPE)type;
+			params.octaves = octaves;
+			params.gain = gain;
+
+			FractalNoise reference(PerlinNoise(1337), params);
+			Clock::time_point start = Clock::now();
+			generateHeightmap(jobs, reference, full.data(), size, size, glm::vec2(0.0f), 1.0f / 256.0f);
+			double fullMs = millisecondsSince(start);
+
+			params.quantizeLevels = 65535;
+			FractalNoise quantized(PerlinNoise(1337), params);
+			start = Clock::now();
+			generateHeightmap(jobs, quantized, early.data(), size, size, glm::vec2(0.0f), 1.0f / 256.0f);
+			double earlyMs = millisecondsSince(start);
+
+			Heightmap a = Heightmap::fromFloats(full.data(), size, size, HEIGHT_R16);
+			Heightmap b = Heightmap::fromFloats(early.data(), size, size, HEIGHT_R16);
+			bool identical = memcmp(a.data(), b.data(), a.sizeBytes()) == 0;
+
+			std::cout << "  " << names[type] << " gain: " << gain << " octaves: " << octaves
+				<< "  all octaves: " << fullMs << " ms"
+				<< "  early-out: " << earlyMs << " ms"
+				<< "  speedup: " << fullMs / earlyMs << "x"
+				<< "  R16 identical: " << (identical ? "yes" : "NO") << '\n';
+			std::string name = key("fbm/", names[type], "/gain ", gain, "/octaves ", octaves);
+			record(name + "/all octaves", fullMs, "ms", false);
+			record(name + "/early-out", earlyMs, "ms", false);
+		}
+	}
+}
+
+static void benchGraph(int size) {
+	using namespace noise_graph;
+
+	PerlinNoise base(1337), warpX(7), warpY(13);
+	FractalParams params;
+	params.octaves = 6;
+	FractalNoise fbm(base, params);
+	CurveTable terraces = { { 0.0f, 0.0f }, { 0.4f, 0.3f }, { 0.7f, 0.75f }, { 1.0f, 1.0f } };
+
+	// fbm plus a domain warped detail layer, remapped and clamped
+	auto fused = clampNode(curveNode(
+		Fractal(fbm) + warpNode(Perlin(base, 4.0f), Perlin(warpX), Perlin(warpY), 0.5f) * 0.25f,
+		terraces), 0.0f, 1.0f);
+
+	NoiseGraph runtime;
+	int detail = runtime.warp(runtime.perlin(base, 4.0f), runtime.perlin(warpX), runtime.perlin(warpY), 0.5f);
+	int sum = runtime.add(runtime.fractal(fbm), runtime.mul(detail, runtime.constant(0.25f)));
+	runtime.clamp(runtime.curve(sum, terraces), 0.0f, 1.0f);
+
+	std::vector<float> a((size_t)size * size), b((size_t)size * size);
+	std::cout << "noise graph, " << size << "x" << size << ", " << runtime.size() << " nodes, single thread\n";
+
+	Clock::time_point start = Clock::now();
+	generateRegion(fused, a.data(), size, 0, 0, size, size, glm::vec2(0.0f), 1.0f / 256.0f);
+	double fusedMs = millisecondsSince(start);
+
+	start = Clock::now();
+	runtime.generateRegion(b.data(), size, 0, 0, size, size, glm::vec2(0.0f), 1.0f / 256.0f);
+	double runtimeMs = millisecondsSince(start);
+
+	std::cout << "  fused templates: " << fusedMs << " ms"
+		<< "  runtime graph: " << runtimeMs << " ms"
+		<< "  speedup: " << runtimeMs / fusedMs << "x"
+		<< "  identical: " << (memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0 ? "yes" : "NO") << '\n';
+	record("graph/fused templates", fusedMs, "ms", false);
+	record("graph/runtime graph", runtimeMs, "ms", false);
+}
+
+// drops the file from the OS page cache so the next read really hits the disk
+static bool evictFromPageCache(const std::string& path) {
+#ifndef _WIN32
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	fdatasync(fd);
+	bool evicted = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+	close(fd);
+	return evicted;
+#else
+	return false;
+#endif
+}
+
+// reads one byte per page, the same page faults the texture upload would take
+static unsigned touchPages(const HeightmapFile& file) {
+	unsigned sum = 0;
+	size_t sampleSize = heightFormatSize(file.format());
+	for (int ty = 0; ty < file.tilesY(); ty++) {
+		for (int tx = 0; tx < file.tilesX(); tx++) {
+			const unsigned char* tile = (const unsigned char*)file.tile(tx, ty);
+			size_t bytes = (size_t)file.tileWidth(tx) * file.tileHeight(ty) * sampleSize;
+			for (size_t i = 0; i < bytes; i += 4096) {
+				sum += tile[i];
+			}
+		}
+	}
+	return sum;
+}
+
+static void benchLoad(const std::string& imagePath) {
+	std::string hmapPath = (std::filesystem::temp_directory_path() / "benchmark_heightmap.hmap").string();
+
+	Heightmap source;
+	if (!source.load(imagePath) || !HeightmapFile::write(hmapPath, source, HMAP_DEFAULT_TILE_SIZE)) {
+		return;
+	}
+
+	std::cout << "heightmap load, " << imagePath << " (" << source.width() << "x" << source.height() << ")\n";
+
+	for (int run = 0; run < 2; run++) {
+		bool cold = run == 0;
+		if (cold && !(evictFromPageCache(imagePath) && evictFromPageCache(hmapPath))) {
+			std::cout << "  (could not evict the files from the page cache, cold numbers are warm)\n";
+		}
+
+		Clock::time_point start = Clock::now();
+		Heightmap decoded;
+		decoded.load(imagePath);
+		double stbiMs = millisecondsSince(start);
+
+		start = Clock::now();
+		HeightmapFile mapped;
+		mapped.open(hmapPath);
+		double openMs = millisecondsSince(start);
+		volatile unsigned sink = touchPages(mapped);
+		(void)sink;
+		double mappedMs = millisecondsSince(start);
+
+		std::cout << (cold ? "  cold" : "  warm")
+			<< "  stbi_load: " << stbiMs << " ms"
+			<< "  hmap open: " << openMs << " ms"
+			<< "  hmap open + page in: " << mappedMs << " ms"
+			<< "  speedup: " << stbiMs / mappedMs << "x\n";
+
+		// cold numbers depend on the disk and whether the eviction worked
+		if (!cold) {
+			record("load/warm/stbi_load", stbiMs, "ms", false);
+			record("load/warm/hmap open + page in", mappedMs, "ms", false);
+		}
+	}
+
+	std::filesystem::remove(hmapPath);
+}
+
+static bool samePyramid(const HeightPyramid& a, const HeightPyramid& b) {
+	if (a.levelCount() != b.levelCount()) {
+		return false;
+	}
+	for (int level = 0; level < a.levelCount(); level++) {
+		size_t count = (size_t)a.levelWidth(level) * a.levelHeight(level) * 2;
+		if (memcmp(a.levelData(level), b.levelData(level), count * sizeof(uint16_t)) != 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void benchPyramid(int size) {
+	JobSystem jobs;
+	FractalParams params;
+	params.octaves = 8;
+	FractalNoise fbm(PerlinNoise(1337), params);
+	std::vector<float> heights((size_t)size * size);
+	generateHeightmap(jobs, fbm, heights.data(), size, size, glm::vec2(0.0f), 1.0f / 256.0f);
+
+	SIMD_LEVEL best = detectSimdLevel();
+	const int tile = 256;
+
+	for (HEIGHT_FORMAT format : { HEIGHT_R16, HEIGHT_R32F }) {
+		Heightmap map = Heightmap::fromFloats(heights.data(), size, size, format);
+
+		std::cout << "min/max pyramid, " << size << "x" << size << (format == HEIGHT_R16 ? " R16" : " R32F") << '\n';
+
+		HeightPyramid reference;
+		for (int level = SIMD_SCALAR; level <= best; level++) {
+			setSimdLevel((SIMD_LEVEL)level);
+			HeightPyramid pyramid;
+			pyramid.build(map);
+
+			// best of a few runs, the first one also faults the pages in
+			double ms = 1e30;
+			for (int run = 0; run < 5; run++) {
+				Clock::time_point start = Clock::now();
+				pyramid.build(map);
+				ms = std::min(ms, millisecondsSince(start));
+			}
+			if (level == SIMD_SCALAR) {
+				reference.build(map);
+			}
+
+			std::cout << "  " << simdLevelName((SIMD_LEVEL)level)
+				<< "  full build: " << ms << " ms"
+				<< "  Mtexels/s: " << (double)size * size / (ms * 1000.0)
+				<< "  identical: " << (samePyramid(pyramid, reference) ? "yes" : "NO") << '\n';
+			record(key("pyramid/", format == HEIGHT_R16 ? "R16/" : "R32F/", simdLevelName((SIMD_LEVEL)level)),
+				(double)size * size / (ms * 1000.0), "Mtexels/s", true);
+		}
+		setSimdLevel(best);
+
+		// one tile changes, only its leaves and their ancestors are rebuilt
+		std::vector<float> edited = heights;
+		for (int y = size / 2; y < std::min(size, size / 2 + tile); y++) {
+			for (int x = size / 2; x < std::min(size, size / 2 + tile); x++) {
+				edited[(size_t)y * size + x] = std::min(1.0f, edited[(size_t)y * size + x] + 0.25f);
+			}
+		}
+		Heightmap editedMap = Heightmap::fromFloats(edited.data(), size, size, format);
+		HeightPyramid rebuilt;
+		rebuilt.build(editedMap);
+
+		HeightPyramid pyramid;
+		pyramid.build(map);
+		double ms = 1e30;
+		for (int run = 0; run < 5; run++) {
+			Clock::time_point start = Clock::now();
+			pyramid.update(editedMap, size / 2, size / 2, tile, tile);
+			ms = std::min(ms, millisecondsSince(start));
+		}
+
+		std::cout << "  " << tile << "x" << tile << " tile update: " << ms << " ms"
+			<< "  matches a full build: " << (samePyramid(pyramid, rebuilt) ? "yes" : "NO")
+			<< "  levels: " << pyramid.levelCount()
+			<< "  memory: " << pyramid.sizeBytes() / 1024 << " KiB"
+			<< " (" << (double)pyramid.sizeBytes() / map.sizeBytes() * 100.0 << "% of the heightmap)\n";
+		record(key("pyramid/", format == HEIGHT_R16 ? "R16" : "R32F", "/tile update"), ms, "ms", false);
+	}
+}
+
+/*
+	Distance to the first crossing of the bilinear surface found by marching
+	the ray in small steps and bisecting the step where it changes side, or
+	-1 for a miss. Slow and independent of the pyramid, the reference the
+	raycaster is checked against. Stops below the lowest possible height,
+	where a descending ray can no longer meet the terrain.
+*/
+static float marchRay(const Heightmap& map, const Ray& ray, float step) {
+	int w = map.width(), h = map.height();
+	auto inside = [w, h](glm::vec3 p) {
+		return p.x >= 0.0f && p.z >= 0.0f && p.x <= (float)(w - 1) && p.z <= (float)(h - 1);
+	};
+	auto above = [&map, w, h](glm::vec3 p) {
+		int cx = std::min((int)p.x, w - 2), cz = std::min((int)p.z, h - 2);
+		float u = p.x - (float)cx, v = p.z - (float)cz;
+		auto texel = [&map](int x, int z) { return worldHeight(map.sample(x, z)); };
+		float ground = (texel(cx, cz) * (1.0f - u) + texel(cx + 1, cz) * u) * (1.0f - v)
+			+ (texel(cx, cz + 1) * (1.0f - u) + texel(cx + 1, cz + 1) * u) * v;
+		return p.y - ground;
+	};
+
+	glm::vec3 direction = glm::normalize(ray.direction);
+	float lowest = worldHeight(0.0f);
+	float end = std::min(ray.maxDistance, (float)(w + h) * 2.0f);
+	bool havePrevious = false;
+	float previous = 0.0f, previousT = 0.0f;
+	for (float t = 0.0f; t <= end; t += step) {
+		glm::vec3 p = ray.origin + direction * t;
+		if (direction.y < 0.0f && p.y < lowest) {
+			break;
+		}
+		if (!inside(p)) {
+			havePrevious = false;
+			continue;
+		}
+
+		float gap = above(p);
+		if (havePrevious && (gap > 0.0f) != (previous > 0.0f)) {
+			float a = previousT, b = t;
+			for (int k = 0; k < 40; k++) {
+				float mid = (a + b) * 0.5f;
+				if ((above(ray.origin + direction * mid) > 0.0f) == (previous > 0.0f)) {
+					a = mid;
+				}
+				else {
+					b = mid;
+				}
+			}
+			return (a + b) * 0.5f;
+		}
+		havePrevious = true;
+		previous = gap;
+		previousT = t;
+	}
+	return -1.0f;
+}
+
+static void benchRaycast(int size) {
+	JobSystem jobs;
+	FractalParams params;
+	params.octaves = 8;
+	FractalNoise fbm(PerlinNoise(1337), params);
+	std::vector<float> heights((size_t)size * size);
+	generateHeightmap(jobs, fbm, heights.data(), size, size, glm::vec2(0.0f), 1.0f / 256.0f);
+	Heightmap map = Heightmap::fromFloats(heights.data(), size, size, HEIGHT_R16);
+	HeightPyramid pyramid;
+	pyramid.build(map);
+	TerrainRaycaster raycaster(map, pyramid);
+
+	std::cout << "terrain raycast, " << size << "x" << size << " R16, " << jobs.threadCount() << " threads\n";
+
+	XorShift xorshift;
+	auto random = [&xorshift]() { return xorshift.next(); };
+
+	const int count = 100000;
+	const char* names[] = { "picking", "line of sight" };
+	for (int kind = 0; kind < 2; kind++) {
+		std::vector<Ray> rays(count);
+		for (Ray& ray : rays) {
+			float x = random() * (size - 1), z = random() * (size - 1);
+			float ground = worldHeight(map.sample((int)x, (int)z));
+			if (kind == 0) {
+				// from a camera above the ground, down into the view
+				ray.origin = glm::vec3(x, ground + 2.0f + random() * 40.0f, z);
+				ray.direction = glm::vec3(random() * 2.0f - 1.0f, -0.2f - random(), random() * 2.0f - 1.0f);
+			}
+			else {
+				// between two points just above the ground, nearly level
+				ray.origin = glm::vec3(x, ground + 2.0f, z);
+				glm::vec3 target(x + random() * 512.0f - 256.0f, 0.0f, z + random() * 512.0f - 256.0f);
+				target.y = ground + 2.0f + random() * 8.0f - 4.0f;
+				ray.direction = target - ray.origin;
+				ray.maxDistance = glm::length(ray.direction);
+			}
+		}
+
+		// best of a few runs
+		std::vector<RayHit> hits(count), batched(count);
+		double serialMs = 1e30, batchedMs = 1e30;
+		for (int run = 0; run < 5; run++) {
+			Clock::time_point start = Clock::now();
+			raycaster.raycast(rays.data(), hits.data(), count);
+			serialMs = std::min(serialMs, millisecondsSince(start));
+
+			start = Clock::now();
+			raycaster.raycast(jobs, rays.data(), batched.data(), count);
+			batchedMs = std::min(batchedMs, millisecondsSince(start));
+		}
+
+		int hitCount = 0;
+		bool identical = true;
+		for (int i = 0; i < count; i++) {
+			hitCount += hits[i].hit;
+			identical = identical && hits[i].hit == batched[i].hit && hits[i].distance == batched[i].distance;
+		}
+
+		// every 50th ray against a brute-force march, hit or miss and the distance to within a few marching steps
+		const float step = 0.01f;
+		int checked = 0, disagree = 0;
+		double largestError = 0.0;
+		for (int i = 0; i < count; i += 50) {
+			float reference = marchRay(map, rays[i], step);
+			checked++;
+			if ((reference >= 0.0f) != hits[i].hit) {
+				disagree++;
+			}
+			else if (hits[i].hit) {
+				double error = std::fabs((double)reference - hits[i].distance);
+				largestError = std::max(largestError, error);
+				disagree += error > 5.0 * step;
+			}
+		}
+
+		std::cout << "  " << names[kind] << ": " << count << " rays, " << hitCount * 100.0 / count << "% hit"
+			<< "  one thread: " << serialMs << " ms (" << count / serialMs << " rays/ms)"
+			<< "  batched: " << batchedMs << " ms (" << count / batchedMs << " rays/ms)"
+			<< "  identical: " << (identical ? "yes" : "NO") << '\n'
+			<< "    brute-force march: " << checked << " rays, " << disagree << " disagree"
+			<< "  largest distance error: " << largestError << '\n';
+		record(key("raycast/", names[kind], "/one thread"), count / serialMs, "rays/ms", true);
+		record(key("raycast/", names[kind], "/batched"), count / batchedMs, "rays/ms", true);
+	}
+}
+
+static void benchSample(int size) {
+	JobSystem jobs;
+	FractalParams params;
+	params.octaves = 8;
+	FractalNoise fbm(PerlinNoise(1337), params);
+	std::vector<float> heights((size_t)size * size);
+	generateHeightmap(jobs, fbm, heights.data(), size, size, glm::vec2(0.0f), 1.0f / 256.0f);
+
+	XorShift xorshift;
+	auto random = [&xorshift]() { return xorshift.next(); };
+
+	// scattered over the whole map, and a 1000 x 1000 block a tenth of a texel apart
+	const int count = 1000000;
+	std::vector<float> scatteredX(count), scatteredZ(count), blockX(count), blockZ(count);
+	for (int i = 0; i < count; i++) {
+		scatteredX[i] = random() * (size - 1);
+		scatteredZ[i] = random() * (size - 1);
+		blockX[i] = size * 0.5f + (i % 1000) * 0.1f;
+		blockZ[i] = size * 0.5f + (i / 1000) * 0.1f;
+	}
+
+	SIMD_LEVEL best = detectSimdLevel();
+	std::vector<float> out(count), nx(count), ny(count), nz(count);
+	std::vector<float> refHeights(count), refX(count), refY(count), refZ(count);
+
+	for (HEIGHT_FORMAT format : { HEIGHT_R16, HEIGHT_R32F }) {
+		Heightmap map = Heightmap::fromFloats(heights.data(), size, size, format);
+		HeightSampler sampler(map);
+
+		std::cout << "height sampling, " << size << "x" << size << (format == HEIGHT_R16 ? " R16" : " R32F") << '\n';
+
+		for (int pattern = 0; pattern < 2; pattern++) {
+			const float* x = pattern == 0 ? scatteredX.data() : blockX.data();
+			const float* z = pattern == 0 ? scatteredZ.data() : blockZ.data();
+			std::cout << "  " << (pattern == 0 ? "scattered" : "block") << '\n';
+
+			// one query at a time, the reference for the batches
+			double ms = 1e30;
+			for (int run = 0; run < 5; run++) {
+				Clock::time_point start = Clock::now();
+				for (int i = 0; i < count; i++) {
+					refHeights[i] = sampler.heightAt(x[i], z[i]);
+				}
+				ms = std::min(ms, millisecondsSince(start));
+			}
+			for (int i = 0; i < count; i++) {
+				glm::vec3 n = sampler.normalAt(x[i], z[i]);
+				refX[i] = n.x;
+				refY[i] = n.y;
+				refZ[i] = n.z;
+			}
+			std::cout << "    heightAt      " << ms << " ms  Mqueries/s: " << count / (ms * 1000.0) << '\n';
+			std::string name = key("sample/", format == HEIGHT_R16 ? "R16/" : "R32F/", pattern == 0 ? "scattered/" : "block/");
+			record(name + "heightAt", count / (ms * 1000.0), "Mqueries/s", true);
+
+			for (int level = SIMD_SCALAR; level <= best; level++) {
+				setSimdLevel((SIMD_LEVEL)level);
+				double heightMs = 1e30, normalMs = 1e30;
+				for (int run = 0; run < 5; run++) {
+					Clock::time_point start = Clock::now();
+					sampler.heightsAt(x, z, out.data(), count);
+					heightMs = std::min(heightMs, millisecondsSince(start));
+				}
+				bool identical = memcmp(out.data(), refHeights.data(), count * sizeof(float)) == 0;
+				for (int run = 0; run < 5; run++) {
+					Clock::time_point start = Clock::now();
+					sampler.sample(x, z, out.data(), nx.data(), ny.data(), nz.data(), count);
+					normalMs = std::min(normalMs, millisecondsSince(start));
+				}
+				identical = identical && memcmp(out.data(), refHeights.data(), count * sizeof(float)) == 0 &&
+					memcmp(nx.data(), refX.data(), count * sizeof(float)) == 0 &&
+					memcmp(ny.data(), refY.data(), count * sizeof(float)) == 0 &&
+					memcmp(nz.data(), refZ.data(), count * sizeof(float)) == 0;
+
+				std::cout << "    " << simdLevelName((SIMD_LEVEL)level)
+					<< "  heights: " << count / (heightMs * 1000.0) << " Mqueries/s"
+					<< "  with normals: " << count / (normalMs * 1000.0) << " Mqueries/s"
+					<< "  identical: " << (identical ? "yes" : "NO") << '\n';
+				record(name + simdLevelName((SIMD_LEVEL)level) + "/heights", count / (heightMs * 1000.0), "Mqueries/s", true);
+				record(name + simdLevelName((SIMD_LEVEL)level) + "/with normals", count / (normalMs * 1000.0), "Mqueries/s", true);
+			}
+			setSimdLevel(best);
+		}
+
+		// the walk camera's per-frame lookup, through the resident tiles
+		HeightTiles tiles(128);
+		tiles.build(size, size, format, [&map](int x, int y) { return map.sample(x, y); });
+		double ms = 1e30;
+		for (int run = 0; run < 5; run++) {
+			Clock::time_point start = Clock::now();
+			for (int i = 0; i < count; i++) {
+				tiles.heightAt(scatteredX[i], scatteredZ[i], out[i]);
+			}
+			ms = std::min(ms, millisecondsSince(start));
+		}
+		float largest = 0.0f;
+		for (int i = 0; i < count; i++) {
+			largest = std::max(largest, std::fabs(out[i] - sampler.heightAt(scatteredX[i], scatteredZ[i])));
+		}
+		std::cout << "  ground tiles: " << tiles.tileCount() << " tiles, " << ms * 1e6 / count << " ns per scattered lookup"
+			<< "  largest difference to the whole map: " << largest << '\n';
+		record(key("sample/", format == HEIGHT_R16 ? "R16" : "R32F", "/ground tiles"), ms * 1e6 / count, "ns", false);
+	}
+}
+
+static void benchErosion(int size, unsigned maxThreads) {
+	std::vector<float> heights((size_t)size * size);
+	{
+		JobSystem jobs;
+		FractalParams params;
+		params.octaves = 8;
+		FractalNoise fbm(PerlinNoise(1337), params);
+		generateHeightmap(jobs, fbm, heights.data(), size, size, glm::vec2(0.0f), 1.0f / 256.0f);
+	}
+
+	HydraulicParams erosion;
+	erosion.droplets = size * size / 4;
+	std::cout << "hydraulic erosion, " << size << "x" << size << ", " << erosion.droplets << " droplets\n";
+
+	std::vector<float> reference, eroded;
+	double baseline = 0.0;
+	for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+		JobSystem jobs(threads);
+
+		eroded = heights;
+		Clock::time_point start = Clock::now();
+		erodeHydraulic(jobs, eroded.data(), size, size, erosion);
+		double ms = millisecondsSince(start);
+
+		if (threads == 1) {
+			baseline = ms;
+			reference = eroded;
+		}
+
+		double speedup = baseline / ms;
+		bool identical = memcmp(eroded.data(), reference.data(), eroded.size() * sizeof(float)) == 0;
+		std::cout << "  threads: " << threads
+			<< "  time: " << ms << " ms"
+			<< "  Mdroplets/s: " << erosion.droplets / (ms * 1000.0)
+			<< "  speedup: " << speedup
+			<< "  identical to one thread: " << (identical ? "yes" : "NO") << '\n';
+		record(key("erosion/threads ", threads), erosion.droplets / (ms * 1000.0), "Mdroplets/s", true);
+	}
+
+	double moved = 0.0;
+	for (size_t i = 0; i < heights.size(); i++) {
+		moved += std::fabs(reference[i] - heights[i]);
+	}
+	std::cout << "  mean height change: " << moved / heights.size() * HEIGHT_SCALE << " world units\n";
+}
+
+static void benchThermal(int size, int iterations) {
+	JobSystem jobs;
+	std::vector<float> heights((size_t)size * size);
+	{
+		FractalParams params;
+		params.octaves = 8;
+		FractalNoise fbm(PerlinNoise(1337), params);
+		generateHeightmap(jobs, fbm, heights.data(), size, size, glm::vec2(0.0f), 1.0f / 256.0f);
+	}
+
+	ThermalParams thermal;
+	thermal.iterations = iterations;
+	thermal.talus = 0.15f; // this fbm is gentle, at the default talus hardly anything slides
+	std::cout << "thermal erosion, " << size << "x" << size << ", " << iterations << " iterations\n";
+
+	SIMD_LEVEL best = detectSimdLevel();
+	std::vector<float> reference, eroded;
+	for (int blockSteps : { 1, thermal.blockSteps }) {
+		ThermalParams params = thermal;
+		params.blockSteps = blockSteps;
+		for (int level = SIMD_SCALAR; level <= best; level++) {
+			setSimdLevel((SIMD_LEVEL)level);
+
+			eroded = heights;
+			Clock::time_point start = Clock::now();
+			erodeThermal(jobs, eroded.data(), size, size, params);
+			double ms = millisecondsSince(start);
+
+			if (reference.empty()) {
+				reference = eroded;
+			}
+
+			bool identical = memcmp(eroded.data(), reference.data(), eroded.size() * sizeof(float)) == 0;
+			std::cout << "  " << (blockSteps == 1 ? "pass per iteration" : "blocked") << ", " << simdLevelName((SIMD_LEVEL)level)
+				<< "  time: " << ms << " ms"
+				<< "  Mcells/s: " << (double)size * size * iterations / (ms * 1000.0)
+				<< "  identical: " << (identical ? "yes" : "NO") << '\n';
+			record(key("thermal/", blockSteps == 1 ? "pass per iteration/" : "blocked/", simdLevelName((SIMD_LEVEL)level)),
+				(double)size * size * iterations / (ms * 1000.0), "Mcells/s", true);
+		}
+	}
+	setSimdLevel(best);
+
+	double moved = 0.0, before = 0.0, after = 0.0;
+	for (size_t i = 0; i < heights.size(); i++) {
+		moved += std::fabs(reference[i] - heights[i]);
+		before += heights[i];
+		after += reference[i];
+	}
+	std::cout << "  mean height change: " << moved / heights.size() * HEIGHT_SCALE << " world units"
+		<< "  total height drift: " << (after - before) * HEIGHT_SCALE << " world units\n";
+}
+
+// geometry.hpp's plane before it wrote into exactly sized buffers: a vector per row, grown one float at a time
+static std::vector<GLfloat> growingPlane(glm::vec3 v0, glm::vec3 v1, glm::vec3 v2, glm::vec3 v3, int div) {
+	std::vector<GLfloat> vertices;
+	vertices.reserve(2 * div);
+	glm::vec3 basisX = (v3 - v0) / (float)div;
+	glm::vec3 basisY = (v2 - v1) / (float)div;
+	for (int i = 0; i <= div; i++) {
+		glm::vec3 start = v0 + basisX * (float)i;
+		glm::vec3 end = v1 + basisY * (float)i;
+		glm::vec3 direction = (end - start) / (float)div;
+		std::vector<GLfloat> row;
+		row.reserve(div * 3);
+		for (int j = 0; j <= div; j++) {
+			glm::vec3 current = start + direction * (float)j;
+			row.emplace_back(current.x);
+			row.emplace_back(current.y);
+			row.emplace_back(current.z);
+		}
+		for (GLfloat v : row) {
+			vertices.emplace_back(v);
+		}
+	}
+	return vertices;
+}
+
+static std::vector<GLuint> growingPlaneIndices(int div) {
+	std::vector<GLuint> indices;
+	indices.reserve(6 * div);
+	for (int i = 0; i < div; i++) {
+		for (int j = 0; j < div; j++) {
+			int index = i * (div + 1) + j;
+			indices.emplace_back(index);
+			indices.emplace_back(index + div + 1 + 1);
+			indices.emplace_back(index + div + 1);
+			indices.emplace_back(index);
+			indices.emplace_back(index + 1);
+			indices.emplace_back(index + div + 1 + 1);
+		}
+	}
+	return indices;
+}
+
+// patch bounds from every texel, what patchHeightBounds() did before it read the pyramid; the exact ranges
+static void scannedPatchBounds(glm::vec2* bounds, int rez, const Heightmap& map) {
+	int width = map.width(), height = map.height();
+	for (int i = 0; i < rez; i++) {
+		int x0 = (int)std::floor((float)width * i / (float)rez - 0.5f);
+		int x1 = (int)std::ceil((float)width * (i + 1) / (float)rez - 0.5f);
+		for (int j = 0; j < rez; j++) {
+			int y0 = (int)std::floor((float)height * j / (float)rez - 0.5f);
+			int y1 = (int)std::ceil((float)height * (j + 1) / (float)rez - 0.5f);
+
+			float lo = 1.0f, hi = 0.0f;
+			for (int y = y0; y <= y1; y++) {
+				for (int x = x0; x <= x1; x++) {
+					float h = map.sample(((x % width) + width) % width, ((y % height) + height) % height);
+					lo = std::min(lo, h);
+					hi = std::max(hi, h);
+				}
+			}
+			bounds[i * rez + j] = glm::vec2(worldHeight(lo), worldHeight(hi));
+		}
+	}
+}
+
+static void benchMesh(int divisions, int size) {
+	std::cout << "mesh building, " << divisions << "x" << divisions << " plane, " << size << "x" << size << " heightmap\n";
+
+	// geometry.hpp's vertex plane: the old growing vectors, the exactly sized ones plane() returns now, and
+	// writePlane() into buffers that are reused like a mapped GL buffer would be, interleaved and one array per axis
+	const glm::vec3 v0(0.0f, 0.0f, 0.0f), v1(1.0f, 0.0f, 0.0f), v2(1.0f, 0.0f, 1.0f), v3(0.0f, 0.0f, 1.0f);
+	const double planeVertices = (double)planeVertexCount(divisions);
+	const double planeTriangles = (double)planeIndexCount(divisions) / 3.0;
+	{
+		std::vector<GLfloat> reference, vertices;
+		double growingMs = 1e30, exactMs = 1e30, spanMs = 1e30, soaMs = 1e30;
+		for (int run = 0; run < 5; run++) {
+			reference.clear();
+			reference.shrink_to_fit();
+			Clock::time_point start = Clock::now();
+			reference = growingPlane(v0, v1, v2, v3, divisions);
+			growingMs = std::min(growingMs, millisecondsSince(start));
+		}
+		for (int run = 0; run < 5; run++) {
+			vertices.clear();
+			vertices.shrink_to_fit();
+			Clock::time_point start = Clock::now();
+			vertices = plane(v0, v1, v2, v3, divisions);
+			exactMs = std::min(exactMs, millisecondsSince(start));
+		}
+		bool identical = vertices == reference;
+		for (int run = 0; run < 5; run++) {
+			Clock::time_point start = Clock::now();
+			writePlane(vertices, v0, v1, v2, v3, divisions);
+			spanMs = std::min(spanMs, millisecondsSince(start));
+		}
+		identical = identical && vertices == reference;
+		vertices = std::vector<GLfloat>();
+
+		std::vector<GLfloat> x(planeVertexCount(divisions)), y(x.size()), z(x.size());
+		for (int run = 0; run < 5; run++) {
+			Clock::time_point start = Clock::now();
+			writePlane(x, y, z, v0, v1, v2, v3, divisions);
+			soaMs = std::min(soaMs, millisecondsSince(start));
+		}
+		for (size_t i = 0; i < x.size(); i++) {
+			identical = identical && x[i] == reference[i * 3] && y[i] == reference[i * 3 + 1] && z[i] == reference[i * 3 + 2];
+		}
+
+		std::cout << "  plane  growing: " << growingMs << " ms"
+			<< "  exact vector: " << exactMs << " ms"
+			<< "  span: " << spanMs << " ms"
+			<< "  span, per axis: " << soaMs << " ms"
+			<< "  Mvertices/s: " << planeVertices / (spanMs * 1000.0)
+			<< "  identical: " << (identical ? "yes" : "NO") << '\n';
+		record("mesh/plane", planeVertices / (exactMs * 1000.0), "Mvertices/s", true);
+		record("mesh/plane/growing", planeVertices / (growingMs * 1000.0), "Mvertices/s", true);
+		record("mesh/plane/span", planeVertices / (spanMs * 1000.0), "Mvertices/s", true);
+		record("mesh/plane/span per axis", planeVertices / (soaMs * 1000.0), "Mvertices/s", true);
+	}
+	{
+		std::vector<GLuint> reference, indices;
+		double growingMs = 1e30, exactMs = 1e30, spanMs = 1e30;
+		for (int run = 0; run < 5; run++) {
+			reference.clear();
+			reference.shrink_to_fit();
+			Clock::time_point start = Clock::now();
+			reference = growingPlaneIndices(divisions);
+			growingMs = std::min(growingMs, millisecondsSince(start));
+		}
+		for (int run = 0; run < 5; run++) {
+			indices.clear();
+			indices.shrink_to_fit();
+			Clock::time_point start = Clock::now();
+			indices = planeIndices(divisions);
+			exactMs = std::min(exactMs, millisecondsSince(start));
+		}
+		bool identical = indices == reference;
+		for (int run = 0; run < 5; run++) {
+			Clock::time_point start = Clock::now();
+			writePlaneIndices(indices, divisions);
+			spanMs = std::min(spanMs, millisecondsSince(start));
+		}
+		identical = identical && indices == reference;
+
+		std::cout << "  planeIndices  growing: " << growingMs << " ms"
+			<< "  exact vector: " << exactMs << " ms"
+			<< "  span: " << spanMs << " ms"
+			<< "  Mtriangles/s: " << planeTriangles / (spanMs * 1000.0)
+			<< "  identical: " << (identical ? "yes" : "NO") << '\n';
+		record("mesh/planeIndices", planeTriangles / (exactMs * 1000.0), "Mtriangles/s", true);
+		record("mesh/planeIndices/growing", planeTriangles / (growingMs * 1000.0), "Mtriangles/s", true);
+		record("mesh/planeIndices/span", planeTriangles / (spanMs * 1000.0), "Mtriangles/s", true);
+	}
+
+	// main.cpp's patch grid over a fixed heightmap
+	const int rez = 20;
+	std::vector<float> heights((size_t)size * size);
+	{
+		JobSystem jobs;
+		FractalParams params;
+		params.octaves = 8;
+		FractalNoise fbm(PerlinNoise(1337), params);
+		generateHeightmap(jobs, fbm, heights.data(), size, size, glm::vec2(0.0f), 1.0f / 256.0f);
+	}
+	Heightmap map = Heightmap::fromFloats(heights.data(), size, size, HEIGHT_R16);
+	std::function<float(int, int)> sample = [&map](int x, int y) { return map.sample(x, y); };
+
+	std::vector<glm::vec2> bounds((size_t)rez * rez), scanned((size_t)rez * rez);
+	std::vector<PatchRoughness> roughness((size_t)rez * rez);
+	std::vector<float> patches(patchGridFloats(rez));
+	HeightPyramid pyramid;
+	double pyramidMs = 1e30, boundsMs = 1e30, scanMs = 1e30, roughnessMs = 1e30, writeMs = 1e30;
+	for (int run = 0; run < 3; run++) {
+		Clock::time_point start = Clock::now();
+		pyramid.build(map);
+		pyramidMs = std::min(pyramidMs, millisecondsSince(start));
+
+		start = Clock::now();
+		patchHeightBounds(bounds.data(), glm::vec2(0.0f), glm::vec2(1.0f), rez, pyramid);
+		boundsMs = std::min(boundsMs, millisecondsSince(start));
+
+		start = Clock::now();
+		scannedPatchBounds(scanned.data(), rez, map);
+		scanMs = std::min(scanMs, millisecondsSince(start));
+
+		start = Clock::now();
+		patchRoughness(roughness.data(), glm::vec2(0.0f), glm::vec2(1.0f), rez, size, size, sample);
+		roughnessMs = std::min(roughnessMs, millisecondsSince(start));
+
+		start = Clock::now();
+		writePatchGrid(patches.data(), glm::vec2(-size / 2.0f), glm::vec2((float)size), glm::vec2(0.0f), glm::vec2(1.0f), rez,
+			bounds.data(), roughness.data());
+		writeMs = std::min(writeMs, millisecondsSince(start));
+	}
+	// the pyramid may only widen the exact ranges
+	bool conservative = true;
+	double slack = 0.0;
+	for (size_t i = 0; i < bounds.size(); i++) {
+		conservative = conservative && bounds[i].x <= scanned[i].x && bounds[i].y >= scanned[i].y;
+		slack += (scanned[i].x - bounds[i].x) + (bounds[i].y - scanned[i].y);
+	}
+	std::cout << "  " << rez << "x" << rez << " patches  pyramid: " << pyramidMs << " ms"
+		<< "  height bounds: " << boundsMs << " ms (texel scan " << scanMs << " ms)"
+		<< "  conservative: " << (conservative ? "yes" : "NO")
+		<< "  mean slack: " << slack / bounds.size() << " world units\n"
+		<< "  roughness: " << roughnessMs << " ms"
+		<< "  vertices: " << writeMs << " ms\n";
+	record("mesh/patch pyramid", pyramidMs, "ms", false);
+	record("mesh/patch height bounds", boundsMs, "ms", false);
+	record("mesh/patch roughness", roughnessMs, "ms", false);
+	record("mesh/patch vertices", writeMs, "ms", false);
+}
+
+static void printUsage(const char* program) {
+	std::cout << "usage: " << program << " tiles [size] [max threads]\n"
+		<< "       " << program << " noise [samples]\n"
+		<< "       " << program << " fbm [size]\n"
+		<< "       " << program << " graph [size]\n"
+		<< "       " << program << " load [heightmap]\n"
+		<< "       " << program << " pyramid [size]\n"
+		<< "       " << program << " raycast [size]\n"
+		<< "       " << program << " sample [size]\n"
+		<< "       " << program << " erosion [size] [max threads]\n"
+		<< "       " << program << " thermal [size] [iterations]\n"
+		<< "       " << program << " mesh [plane divisions] [heightmap size]\n"
+		<< "       " << program << " all\n"
+		<< "  add --json <path> to write the results for bench_compare.py" << std::endl;
+}
+
+int main(int argc, char** argv) {
+	// --json <path> may go anywhere, the rest are the suite and its arguments
+	std::string jsonPath;
+	std::vector<std::string> args;
+	for (int i = 1; i < argc; i++) {
+		if (std::string(argv[i]) == "--json" && i + 1 < argc) {
+			jsonPath = argv[++i];
+		}
+		else {
+			args.push_back(argv[i]);
+		}
+	}
+	auto intArg = [&args](size_t i, int fallback) { return args.size() > i ? std::stoi(args[i]) : fallback; };
+
+	std::string suite = args.empty() ? "tiles" : args[0];
+	unsigned hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+
+	if (suite == "tiles") {
+		benchTiledGeneration(intArg(1, 4096), (unsigned)intArg(2, (int)hardwareThreads));
+	}
+	else if (suite == "noise") {
+		benchNoise(intArg(1, 1 << 22));
+	}
+	else if (suite == "fbm") {
+		benchFractal(intArg(1, 2048));
+	}
+	else if (suite == "graph") {
+		benchGraph(intArg(1, 1024));
+	}
+	else if (suite == "load") {
+		benchLoad(args.size() > 1 ? args[1] : "./textures/heightmap.png");
+	}
+	else if (suite == "pyramid") {
+		benchPyramid(intArg(1, 4097));
+	}
+	else if (suite == "raycast") {
+		benchRaycast(intArg(1, 4097));
+	}
+	else if (suite == "sample") {
+		benchSample(intArg(1, 4097));
+	}
+	else if (suite == "erosion") {
+		benchErosion(intArg(1, 2048), (unsigned)intArg(2, (int)hardwareThreads));
+	}
+	else if (suite == "thermal") {
+		benchThermal(intArg(1, 4096), intArg(2, 50));
+	}
+	else if (suite == "mesh") {
+		benchMesh(intArg(1, 4096), intArg(2, 4097));
+	}
+	else if (suite == "all") {
+		// every suite at a size that keeps the whole run to a minute or two, for regression checks
+		benchTiledGeneration(2048, hardwareThreads);
+		benchNoise(1 << 20);
+		benchFractal(512);
+		benchGraph(512);
+		benchLoad("./textures/heightmap.png");
+		benchPyramid(2049);
+		benchRaycast(2049);
+		benchSample(1025);
+		benchErosion(1024, hardwareThreads);
+		benchThermal(1024, 16);
+		benchMesh(1024, 2049);
+	}
+	else {
+		printUsage(argv[0]);
+		return -1;
+	}
+
+	if (!jsonPath.empty() && !writeJson(jsonPath, suite)) {
+		return -1;
+	}
+	return 0;
+}
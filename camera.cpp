@@ -43,7 +43,7 @@ void Camera::look(float xoffset, float yoffset, bool constrainPitch) {
 }
 
 void Camera::move(CAMERA_DIRECTIONS direction, float dt) {
-	if (direction == UP) {
+	if (direction == UP && !m_walking) {
 		m_pos += m_worldUp * m_movementSpeed * dt;
 	}
 	if (direction == FORWARD) {
@@ -84,4 +84,22 @@ glm::vec3 Camera::position() {
 
 void Camera::setPosition(glm::vec3 newPos) {
 	m_pos = newPos;
-}
\ No newline at end of file
+}
+
+void Camera::setWalking(bool walking) {
+	m_walking = walking;
+}
+
+bool Camera::walking() {
+	return m_walking;
+}
+
+void Camera::followGround(float groundHeight, float dt) {
+	if (!m_walking) {
+		return;
+	}
+	// the same easing at any frame rate
+	float target = groundHeight + m_eyeHeight;
+	m_pos.y += (target - m_pos.y) * (1.0f - std::exp(-m_groundFollow * dt));
+	m_pos.y = std::max(m_pos.y, groundHeight + m_eyeHeight * 0.5f);
+}
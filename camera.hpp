@@ -24,6 +24,8 @@ static const float DEFAULT_pitch = 0.0f;
 static const float DEFAULT_movementSpeed = 10.0f;
 static const float DEFAULT_sensitivity = 0.16f;
 static const float DEFAULT_zoom = 1.0f;
+static const float DEFAULT_eyeHeight = 2.0f;
+static const float DEFAULT_groundFollow = 12.0f;
 
 class Camera {
 private:
@@ -36,6 +38,9 @@ private:
 	float m_movementSpeed = DEFAULT_movementSpeed;
 	float m_sensitivity = DEFAULT_sensitivity;
 	float m_zoom = DEFAULT_zoom;
+	bool m_walking = false;
+	float m_eyeHeight = DEFAULT_eyeHeight;
+	float m_groundFollow = DEFAULT_groundFollow; // how fast the eye settles on a new ground height, per second
 public:
 	glm::vec3 m_pos = DEFAULT_pos;
 	Camera(glm::vec3 position, glm::vec3 up,
@@ -51,4 +56,13 @@ public:
 	float zoom();
 	glm::vec3 position();
 	void setPosition(glm::vec3 newPos);
+
+	/*
+		Walk mode keeps the eye m_eyeHeight above the ground: followGround()
+		eases m_pos.y towards it every frame, but never lets it drop below
+		half the eye height above the ground, and UP does nothing.
+	*/
+	void setWalking(bool walking);
+	bool walking();
+	void followGround(float groundHeight, float dt);
 };
\ No newline at end of file
@@ -0,0 +1,395 @@
+#include "chunk_manager.hpp"
+#include "height_pyramid.hpp"
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <unordered_set>
+
+ChunkManager::ChunkManager(JobSystem& jobs, const FractalNoise& noise, const ChunkSettings& settings)
+	: m_jobs(jobs), m_noise(noise), m_settings(settings), m_ground(std::max(1, settings.chunkSize))
+{
+	m_settings.chunkSize = std::max(1, m_settings.chunkSize);
+	m_settings.patchesPerChunk = std::max(1, m_settings.patchesPerChunk);
+	m_settings.viewRadius = std::max(0, m_settings.viewRadius);
+	m_settings.maxUploadsPerFrame = std::max(1, m_settings.maxUploadsPerFrame);
+	if (m_settings.maxJobsInFlight <= 0) {
+		m_settings.maxJobsInFlight = (int)jobs.threadCount();
+	}
+
+	int radius = m_settings.viewRadius;
+	int wanted = 0;
+	for (int dz = -radius; dz <= radius; dz++) {
+		for (int dx = -radius; dx <= radius; dx++) {
+			wanted += dx * dx + dz * dz <= radius * radius + radius;
+		}
+	}
+
+	GLint maxLayers;
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+
+	int n = texels();
+
+	/*
+		Room for every chunk being generated plus the uploads of the last few
+		frames, which the GPU may still be copying from.
+	*/
+	int segments = m_settings.maxJobsInFlight + 3 * m_settings.maxUploadsPerFrame;
+	m_ringMapped = m_ring.create((size_t)n * n * sizeof(uint16_t), segments);
+	if (!m_ringMapped) {
+		// the chunks still stream, uploaded from their CPU copy with an ordinary glTexSubImage3D
+		std::cout << "CHUNKS FALL BACK TO UPLOADS FROM CLIENT MEMORY" << std::endl;
+	}
+	size_t ringBytes = m_ring.segmentSize() * m_ring.segmentCount();
+	size_t budget = m_settings.memoryBudget > ringBytes ? m_settings.memoryBudget - ringBytes : 0;
+
+	// twice the view disc leaves room for chunks that were just left behind
+	size_t slots = budget / chunkBytes();
+	slots = std::min(slots, (size_t)wanted * 2);
+	slots = std::min(slots, (size_t)maxLayers);
+	slots = std::max(slots, (size_t)1);
+	if (slots < (size_t)wanted) {
+		std::cout << "CHUNK MEMORY BUDGET ONLY FITS " << slots << " OF " << wanted << " VISIBLE CHUNKS" << std::endl;
+	}
+
+	glGenTextures(1, &m_texture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_texture);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_R16, n, n, (GLsizei)slots);
+	// each layer holds its own border texels, nothing to wrap around to
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	int patches = m_settings.patchesPerChunk;
+	m_vertices.resize(patchGridFloats(patches));
+	m_slots.resize(slots);
+	for (Slot& slot : m_slots) {
+		glGenVertexArrays(1, &slot.vao);
+		glGenBuffers(1, &slot.vbo);
+
+		glBindVertexArray(slot.vao);
+		glBindBuffer(GL_ARRAY_BUFFER, slot.vbo);
+		glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(float), NULL, GL_DYNAMIC_DRAW);
+
+		setPatchVertexLayout();
+	}
+	glBindVertexArray(0);
+}
+
+ChunkManager::~ChunkManager() {
+	// the jobs still queued read m_noise and write into the ring, let them skip their work and drain
+	for (auto& [k, chunk] : m_pending) {
+		chunk->cancelled = true;
+	}
+	m_jobs.wait();
+	m_ring.destroy();
+
+	for (Slot& slot : m_slots) {
+		glDeleteVertexArrays(1, &slot.vao);
+		glDeleteBuffers(1, &slot.vbo);
+	}
+	glDeleteTextures(1, &m_texture);
+}
+
+int64_t ChunkManager::key(glm::ivec2 coord) {
+	return ((int64_t)coord.x << 32) | (uint32_t)coord.y;
+}
+
+int ChunkManager::texels() const {
+	return m_settings.chunkSize + 1;
+}
+
+size_t ChunkManager::chunkBytes() const {
+	size_t texture = (size_t)texels() * texels() * sizeof(uint16_t);
+	size_t vertices = patchGridFloats(m_settings.patchesPerChunk) * sizeof(float);
+	return texture + vertices;
+}
+
+// texel centers, so the chunk edges sample exactly the shared border texels
+glm::vec2 ChunkManager::patchUvMin() const {
+	return glm::vec2(0.5f / (float)texels());
+}
+
+glm::vec2 ChunkManager::patchUvMax() const {
+	return glm::vec2(((float)texels() - 0.5f) / (float)texels());
+}
+
+int ChunkManager::distance(glm::ivec2 coord) const {
+	glm::ivec2 d = coord - m_center;
+	return d.x * d.x + d.y * d.y;
+}
+
+void ChunkManager::update(const glm::vec3& cameraPos) {
+	glm::ivec2 center = glm::ivec2(glm::floor(glm::vec2(cameraPos.x, cameraPos.z) / (float)m_settings.chunkSize));
+	if (!m_haveCenter || center != m_center) {
+		updateWanted(center);
+	}
+
+	// without worker threads nobody else runs the chunk jobs, take one per frame
+	if (m_jobs.threadCount() == 1) {
+		m_jobs.runPending();
+	}
+
+	uploadChunks();
+	requestChunks();
+}
+
+void ChunkManager::updateWanted(glm::ivec2 center) {
+	m_center = center;
+	m_haveCenter = true;
+
+	int radius = m_settings.viewRadius;
+	m_wanted.clear();
+	for (int dz = -radius; dz <= radius; dz++) {
+		for (int dx = -radius; dx <= radius; dx++) {
+			if (dx * dx + dz * dz <= radius * radius + radius) {
+				m_wanted.push_back(center + glm::ivec2(dx, dz));
+			}
+		}
+	}
+	std::stable_sort(m_wanted.begin(), m_wanted.end(), [this](glm::ivec2 a, glm::ivec2 b) {
+		return distance(a) < distance(b);
+	});
+	// never ask for more chunks than there are slots to hold them
+	if (m_wanted.size() > m_slots.size()) {
+		m_wanted.resize(m_slots.size());
+	}
+
+	m_wantedKeys.clear();
+	for (glm::ivec2 coord : m_wanted) {
+		m_wantedKeys.insert(key(coord));
+	}
+	for (auto it = m_pending.begin(); it != m_pending.end();) {
+		bool keep = m_wantedKeys.count(it->first) > 0;
+		if (!keep && it->second->done) {
+			discard(*it->second);
+			it = m_pending.erase(it);
+			continue;
+		}
+		// a job that has not started yet skips its chunk
+		it->second->cancelled = !keep;
+		++it;
+	}
+}
+
+void ChunkManager::requestChunks() {
+	int inFlight = 0;
+	for (auto& [k, chunk] : m_pending) {
+		inFlight += !chunk->done;
+	}
+
+	const FractalNoise* noise = &m_noise;
+	int n = texels();
+	float scale = m_settings.noiseScale;
+	float chunkExtent = (float)m_settings.chunkSize * scale;
+	int patches = m_settings.patchesPerChunk;
+	glm::vec2 uvMin = patchUvMin(), uvMax = patchUvMax();
+
+	for (glm::ivec2 coord : m_wanted) {
+		if (inFlight >= m_settings.maxJobsInFlight) {
+			break;
+		}
+		int64_t k = key(coord);
+		if (m_resident.count(k) || m_pending.count(k)) {
+			continue;
+		}
+
+		// no free segment until the GPU catches up, try again next frame
+		int segment = -1;
+		if (m_ringMapped) {
+			segment = m_ring.acquire();
+			if (segment < 0) {
+				break;
+			}
+		}
+
+		auto chunk = std::make_shared<PendingChunk>();
+		chunk->coord = coord;
+		chunk->segment = segment;
+		m_pending[k] = chunk;
+		inFlight++;
+
+		uint16_t* texels = segment >= 0 ? (uint16_t*)m_ring.data(segment) : nullptr;
+		m_jobs.submit([chunk, texels, noise, n, scale, chunkExtent, patches, uvMin, uvMax]() {
+			if (!chunk->cancelled) {
+				PROFILE_SCOPE("chunk generation");
+				thread_local std::vector<float> heights;
+				heights.resize((size_t)n * n);
+				/*
+					With a power of two scale the chunk origin and every sample
+					position are exact, so the border texels two neighbouring
+					chunks share come out bit-identical.
+				*/
+				glm::vec2 origin = glm::vec2(chunk->coord) * chunkExtent;
+				noise->generateRegion(heights.data(), n, 0, 0, n, n, origin, scale);
+				chunk->heights = Heightmap(n, n, HEIGHT_R16);
+				quantizeR16(heights.data(), (uint16_t*)chunk->heights.data(), (size_t)n * n);
+				if (texels) {
+					memcpy(texels, chunk->heights.data(), chunk->heights.sizeBytes());
+				}
+
+				// bounds and roughness of the quantized texels, the mapped texels themselves are write only
+				thread_local HeightPyramid pyramid;
+				pyramid.build(chunk->heights);
+				chunk->bounds.resize((size_t)patches * patches);
+				patchHeightBounds(chunk->bounds.data(), uvMin, uvMax, patches, pyramid);
+				auto sample = [&](int x, int y) { return chunk->heights.sample(x, y); };
+				chunk->roughness.resize((size_t)patches * patches);
+				patchRoughness(chunk->roughness.data(), uvMin, uvMax, patches, n, n, sample);
+				chunk->generated = true;
+			}
+			chunk->done.store(true, std::memory_order_release);
+		});
+	}
+}
+
+void ChunkManager::uploadChunks() {
+	// finished jobs for chunks that went out of view
+	for (auto it = m_pending.begin(); it != m_pending.end();) {
+		if (it->second->cancelled && it->second->done.load(std::memory_order_acquire)) {
+			discard(*it->second);
+			it = m_pending.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+
+	int uploads = 0;
+	for (glm::ivec2 coord : m_wanted) {
+		if (uploads >= m_settings.maxUploadsPerFrame) {
+			break;
+		}
+
+		auto it = m_pending.find(key(coord));
+		if (it == m_pending.end() || !it->second->done.load(std::memory_order_acquire)) {
+			continue;
+		}
+
+		std::shared_ptr<PendingChunk> chunk = it->second;
+		m_pending.erase(it);
+		// skipped while it was out of view, requested again by requestChunks()
+		if (!chunk->generated) {
+			discard(*chunk);
+			continue;
+		}
+
+		int slot = acquireSlot(coord);
+		if (slot < 0) {
+			discard(*chunk);
+			continue;
+		}
+		upload(slot, *chunk);
+		uploads++;
+	}
+}
+
+int ChunkManager::acquireSlot(glm::ivec2 coord) {
+	/*
+		Farthest from the camera, and among equally far chunks one that is no
+		longer wanted. Since m_wanted never holds more chunks than there are
+		slots, a full set of slots always has an unwanted chunk at least as far
+		as any wanted one, so a wanted chunk never evicts another.
+	*/
+	int farthest = -1;
+	bool farthestWanted = false;
+	for (int i = 0; i < (int)m_slots.size(); i++) {
+		if (!m_slots[i].used) {
+			return i;
+		}
+		int d = distance(m_slots[i].coord);
+		bool wanted = m_wantedKeys.count(key(m_slots[i].coord)) > 0;
+		if (farthest < 0 || d > distance(m_slots[farthest].coord) ||
+			(d == distance(m_slots[farthest].coord) && farthestWanted && !wanted))
+		{
+			farthest = i;
+			farthestWanted = wanted;
+		}
+	}
+
+	// every slot is taken, a tie still evicts so the finished chunk is not thrown away and regenerated every frame
+	if (farthest < 0 || distance(m_slots[farthest].coord) < distance(coord)) {
+		return -1;
+	}
+	m_resident.erase(key(m_slots[farthest].coord));
+	m_ground.erase(m_slots[farthest].coord);
+	m_slots[farthest].used = false;
+	return farthest;
+}
+
+void ChunkManager::discard(const PendingChunk& chunk) {
+	if (chunk.segment >= 0) {
+		m_ring.release(chunk.segment);
+	}
+}
+
+void ChunkManager::upload(int slot, PendingChunk& chunk) {
+	int n = texels();
+	float size = (float)m_settings.chunkSize;
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_texture);
+	// R16 rows of odd width are not 4 byte aligned
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+	if (chunk.segment >= 0) {
+		// sourced from the bound unpack buffer, the call returns without waiting for the copy
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_ring.buffer());
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, slot, n, n, 1, GL_RED, GL_UNSIGNED_SHORT,
+			(const void*)m_ring.offset(chunk.segment));
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		m_ring.submit(chunk.segment);
+	}
+	else {
+		// no ring: the driver copies the CPU heights before returning
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, slot, n, n, 1, GL_RED, GL_UNSIGNED_SHORT, chunk.heights.data());
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	writePatchGrid(m_vertices.data(), glm::vec2(chunk.coord) * size, glm::vec2(size), patchUvMin(), patchUvMax(),
+		m_settings.patchesPerChunk, chunk.bounds.data(), chunk.roughness.data());
+
+	Slot& s = m_slots[slot];
+	glBindBuffer(GL_ARRAY_BUFFER, s.vbo);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, m_vertices.size() * sizeof(float), m_vertices.data());
+
+	s.coord = chunk.coord;
+	s.used = true;
+	m_resident[key(chunk.coord)] = slot;
+	m_ground.insert(chunk.coord, std::move(chunk.heights));
+}
+
+void ChunkManager::draw(const Shader& shader) const {
+	int vertexCount = 4 * m_settings.patchesPerChunk * m_settings.patchesPerChunk;
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_texture);
+	for (int i = 0; i < (int)m_slots.size(); i++) {
+		if (!m_slots[i].used) {
+			continue;
+		}
+		shader.setInt("heightLayer", i);
+		glBindVertexArray(m_slots[i].vao);
+		glDrawArrays(GL_PATCHES, 0, vertexCount);
+	}
+}
+
+const HeightTiles& ChunkManager::ground() const {
+	return m_ground;
+}
+
+int ChunkManager::slotCount() const {
+	return (int)m_slots.size();
+}
+
+int ChunkManager::residentCount() const {
+	return (int)m_resident.size();
+}
+
+int ChunkManager::pendingCount() const {
+	return (int)m_pending.size();
+}
+
+size_t ChunkManager::memoryUsed() const {
+	return m_slots.size() * chunkBytes() + m_ring.segmentSize() * m_ring.segmentCount();
+}
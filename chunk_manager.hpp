@@ -0,0 +1,118 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "fractal.hpp"
+#include "heightmap.hpp"
+#include "height_tiles.hpp"
+#include "job_system.hpp"
+#include "patch_grid.hpp"
+#include "shader.hpp"
+#include "upload_ring.hpp"
+
+struct ChunkSettings {
+	int chunkSize = 128;        // world units (and heightmap texels) along a chunk edge
+	int patchesPerChunk = 8;    // tessellation patches along a chunk edge
+	int viewRadius = 3;         // chunks kept loaded in every direction around the camera
+	size_t memoryBudget = 32u << 20; // GPU bytes for the chunk texture layers, VBOs and upload ring
+	int maxUploadsPerFrame = 2; // caps the texture and VBO uploads done by update()
+	int maxJobsInFlight = 0;    // chunks generated at once, 0 for one per job system thread
+	float noiseScale = 1.0f / 256.0f;
+};
+
+/*
+	Streams an endless terrain in square chunks around the camera.
+
+	Chunks are generated on the job system straight into a segment of a
+	persistently mapped UploadRing, the render thread only issues the
+	glTexSubImage3D from it in update(), at most maxUploadsPerFrame per
+	frame. If the ring cannot be mapped, the uploads read the chunk's CPU
+	copy from client memory instead. Every chunk lives in a slot: one layer of a GL_TEXTURE_2D_ARRAY
+	plus its own patch VBO. The slots are allocated up front from the memory
+	budget, so streaming never allocates GPU memory, and a chunk that is no
+	longer wanted keeps its slot until a nearer chunk needs it.
+
+	The heightmap of a chunk has chunkSize + 1 texels per side so that
+	neighbours share their border texels and meet without cracks. A CPU
+	copy of it stays in ground() for as long as the chunk is resident.
+*/
+class ChunkManager {
+private:
+	struct PendingChunk {
+		glm::ivec2 coord;
+		int segment = -1;        // upload ring segment the heights are written to, -1 without a ring
+		Heightmap heights;       // the same R16 texels, kept on the CPU for ground queries
+		std::vector<glm::vec2> bounds; // world height range of every patch
+		std::vector<PatchRoughness> roughness;
+		bool generated = false;  // false when the job skipped a cancelled chunk
+		std::atomic<bool> cancelled{ false };
+		std::atomic<bool> done{ false };
+	};
+
+	struct Slot {
+		GLuint vao = 0;
+		GLuint vbo = 0;
+		glm::ivec2 coord = glm::ivec2(0);
+		bool used = false;
+	};
+
+	JobSystem& m_jobs;
+	FractalNoise m_noise;
+	ChunkSettings m_settings;
+
+	GLuint m_texture = 0;
+	UploadRing m_ring;
+	bool m_ringMapped = false;                   // false when the ring could not be mapped, see upload()
+	std::vector<Slot> m_slots;
+	std::unordered_map<int64_t, int> m_resident; // chunk key to slot
+	std::unordered_map<int64_t, std::shared_ptr<PendingChunk>> m_pending;
+	std::vector<glm::ivec2> m_wanted;            // nearest first
+	std::unordered_set<int64_t> m_wantedKeys;    // the same chunks, by key
+	std::vector<float> m_vertices;               // staging for one chunk's patches
+	HeightTiles m_ground;                        // heights of the resident chunks
+	glm::ivec2 m_center = glm::ivec2(0);
+	bool m_haveCenter = false;
+
+	static int64_t key(glm::ivec2 coord);
+	int texels() const;
+	size_t chunkBytes() const;
+	glm::vec2 patchUvMin() const;
+	glm::vec2 patchUvMax() const;
+	int distance(glm::ivec2 coord) const;
+
+	void updateWanted(glm::ivec2 center);
+	void requestChunks();
+	void uploadChunks();
+	int acquireSlot(glm::ivec2 coord);
+	void discard(const PendingChunk& chunk);
+	void upload(int slot, PendingChunk& chunk);
+public:
+	ChunkManager(JobSystem& jobs, const FractalNoise& noise, const ChunkSettings& settings = ChunkSettings());
+	~ChunkManager();
+
+	ChunkManager(const ChunkManager&) = delete;
+	ChunkManager& operator=(const ChunkManager&) = delete;
+
+	// call once per frame on the render thread, before draw()
+	void update(const glm::vec3& cameraPos);
+
+	// draws every resident chunk, the shader samples heightMap as a sampler2DArray at layer heightLayer
+	void draw(const Shader& shader) const;
+
+	// heights of the resident chunks, one tile per chunk
+	const HeightTiles& ground() const;
+
+	int slotCount() const;
+	int residentCount() const;
+	int pendingCount() const;
+
+	// GPU bytes reserved for the slots and the upload ring, at most the memory budget
+	size_t memoryUsed() const;
+};
@@ -0,0 +1,349 @@
+#include "erosion.hpp"
+#include "erosion_simd.hpp"
+#include "heightmap.hpp"
+#include "simd.hpp"
+#include "terrain_gen.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+// tiles narrower than this would leave most threads of a phase idle on the scheduling
+static const int MIN_EROSION_TILE = 64;
+
+// a thermal tile with a blockSteps halo, twice over for the double buffer, stays well inside L2
+static const int THERMAL_TILE = 128;
+
+struct BrushTap {
+	int dx;
+	int dy;
+	int offset; // dy * w + dx, the same tap as an index step in the map
+	float weight;
+};
+
+// weights falling off linearly to the radius, summing to 1
+static std::vector<BrushTap> erosionBrush(int radius, int w) {
+	std::vector<BrushTap> brush;
+	float sum = 0.0f;
+	for (int dy = -radius; dy <= radius; dy++) {
+		for (int dx = -radius; dx <= radius; dx++) {
+			float weight = (float)radius - std::sqrt((float)(dx * dx + dy * dy));
+			if (weight > 0.0f) {
+				brush.push_back({ dx, dy, dy * w + dx, weight });
+				sum += weight;
+			}
+		}
+	}
+	if (brush.empty()) {
+		brush.push_back({ 0, 0, 0, 1.0f });
+		sum = 1.0f;
+	}
+	for (BrushTap& tap : brush) {
+		tap.weight /= sum;
+	}
+	return brush;
+}
+
+// splitmix64 finalizer, spreads consecutive droplet indices over the whole range
+static inline uint64_t hashDroplet(uint32_t seed, uint64_t index) {
+	uint64_t z = index * 0x9E3779B97F4A7C15ull + seed;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+static void runDroplet(float* heights, int w, int h, float x, float y, const HydraulicParams& params,
+	const std::vector<BrushTap>& brush, int radius)
+{
+	const float scale = HEIGHT_SCALE, invScale = 1.0f / HEIGHT_SCALE;
+	// the cell under the droplet and the one after it both need all four corners
+	auto inside = [w, h](float x, float y) {
+		return x >= 0.0f && y >= 0.0f && x < (float)(w - 1) && y < (float)(h - 1);
+	};
+	auto heightAt = [&](float x, float y) {
+		int nx = (int)x, ny = (int)y;
+		float u = x - (float)nx, v = y - (float)ny;
+		const float* t = heights + (size_t)ny * w + nx;
+		float h0 = t[0] + (t[1] - t[0]) * u;
+		float h1 = t[w] + (t[w + 1] - t[w]) * u;
+		return (h0 + (h1 - h0) * v) * scale;
+	};
+
+	// sediment spread over the corners of the cell at (u, v)
+	auto deposit = [w, invScale](float* t, float u, float v, float amount) {
+		amount *= invScale;
+		t[0] += amount * (1.0f - u) * (1.0f - v);
+		t[1] += amount * u * (1.0f - v);
+		t[w] += amount * (1.0f - u) * v;
+		t[w + 1] += amount * u * v;
+	};
+
+	float dirX = 0.0f, dirY = 0.0f;
+	float speed = 1.0f, water = 1.0f, sediment = 0.0f;
+	if (!inside(x, y)) {
+		return;
+	}
+
+	float* t = nullptr;
+	float u = 0.0f, v = 0.0f;
+	for (int step = 0; step < params.maxLifetime; step++) {
+		int nx = (int)x, ny = (int)y;
+		u = x - (float)nx;
+		v = y - (float)ny;
+		t = heights + (size_t)ny * w + nx;
+		float h00 = t[0] * scale, h10 = t[1] * scale, h01 = t[w] * scale, h11 = t[w + 1] * scale;
+
+		float gradX = (h10 - h00) * (1.0f - v) + (h11 - h01) * v;
+		float gradY = (h01 - h00) * (1.0f - u) + (h11 - h10) * u;
+		float height = heightAt(x, y);
+
+		dirX = dirX * params.inertia - gradX * (1.0f - params.inertia);
+		dirY = dirY * params.inertia - gradY * (1.0f - params.inertia);
+		float length = std::sqrt(dirX * dirX + dirY * dirY);
+		// a flat spot, nowhere to run
+		if (length < 1e-6f) {
+			break;
+		}
+		dirX /= length;
+		dirY /= length;
+		x += dirX;
+		y += dirY;
+		if (!inside(x, y)) {
+			break;
+		}
+
+		float deltaHeight = heightAt(x, y) - height;
+		float capacity = std::max(-deltaHeight, params.minSlope) * speed * water * params.capacity;
+
+		if (sediment > capacity || deltaHeight > 0.0f) {
+			// climbing fills the pit behind up to the rim, otherwise part of the excess settles
+			float amount = deltaHeight > 0.0f ? std::min(deltaHeight, sediment) : (sediment - capacity) * params.deposition;
+			sediment -= amount;
+			deposit(t, u, v, amount);
+		}
+		else {
+			// never more than the drop, which would dig a pit the droplet then fills
+			float amount = std::min((capacity - sediment) * params.erosion, -deltaHeight);
+			bool clipped = nx < radius || ny < radius || nx + radius >= w || ny + radius >= h;
+			for (const BrushTap& tap : brush) {
+				if (clipped) {
+					int bx = nx + tap.dx, by = ny + tap.dy;
+					if (bx < 0 || by < 0 || bx >= w || by >= h) {
+						continue;
+					}
+				}
+				float& texel = t[tap.offset];
+				float taken = std::min(texel * scale, amount * tap.weight);
+				texel -= taken * invScale;
+				sediment += taken;
+			}
+		}
+
+		speed = std::sqrt(std::max(0.0f, speed * speed - deltaHeight * params.gravity));
+		water *= 1.0f - params.evaporation;
+	}
+
+	// whatever it still carries settles where it stopped, so no material leaves the map
+	if (t && sediment > 0.0f) {
+		deposit(t, u, v, sediment);
+	}
+}
+
+int erodeHydraulic(JobSystem& jobs, float* heights, int w, int h, const HydraulicParams& params) {
+	if (w < 2 || h < 2 || params.droplets <= 0 || params.maxLifetime <= 0) {
+		return 0;
+	}
+
+	int radius = std::max(0, params.radius);
+	std::vector<BrushTap> brush = erosionBrush(radius, w);
+
+	/*
+		The furthest from its tile a droplet reads or writes: one texel a
+		step, the brush around its cell and the far corners of that cell.
+	*/
+	int reach = params.maxLifetime + radius + 2;
+	int tileSize = std::max(MIN_EROSION_TILE, 2 * reach);
+
+	// droplets start in cells, the last texel row and column start none
+	int cellsX = w - 1, cellsY = h - 1;
+	int tilesX = (cellsX + tileSize - 1) / tileSize;
+	int tilesY = (cellsY + tileSize - 1) / tileSize;
+	int tileCount = tilesX * tilesY;
+
+	// droplets are dealt out by area, tile t of batch b takes the indices in [first(b, t), first(b, t + 1))
+	std::vector<uint64_t> areaBefore(tileCount + 1, 0);
+	for (int t = 0; t < tileCount; t++) {
+		int x0 = (t % tilesX) * tileSize, y0 = (t / tilesX) * tileSize;
+		uint64_t area = (uint64_t)std::min(tileSize, cellsX - x0) * std::min(tileSize, cellsY - y0);
+		areaBefore[t + 1] = areaBefore[t] + area;
+	}
+	int batches = std::max(1, params.batches);
+	uint64_t totalArea = areaBefore[tileCount] * batches;
+	auto first = [&](int batch, int tile) {
+		return (uint64_t)params.droplets * (areaBefore[tileCount] * batch + areaBefore[tile]) / totalArea;
+	};
+
+	std::vector<int> phaseTiles;
+	phaseTiles.reserve(tileCount / 4 + tilesX + tilesY + 1);
+	for (int batch = 0; batch < batches; batch++) {
+		for (int phase = 0; phase < 4; phase++) {
+			phaseTiles.clear();
+			for (int t = 0; t < tileCount; t++) {
+				int tx = t % tilesX, ty = t / tilesX;
+				if ((tx & 1) + 2 * (ty & 1) == phase) {
+					phaseTiles.push_back(t);
+				}
+			}
+
+			jobs.parallelFor((int)phaseTiles.size(), [&](int i) {
+				int t = phaseTiles[i];
+				int x0 = (t % tilesX) * tileSize, y0 = (t / tilesX) * tileSize;
+				float tw = (float)std::min(tileSize, cellsX - x0), th = (float)std::min(tileSize, cellsY - y0);
+
+				uint64_t end = first(batch, t + 1);
+				for (uint64_t droplet = first(batch, t); droplet < end; droplet++) {
+					uint64_t bits = hashDroplet(params.seed, droplet);
+					float x = (float)x0 + (float)(bits & 0xFFFFFF) / (float)0x1000000 * tw;
+					float y = (float)y0 + (float)((bits >> 24) & 0xFFFFFF) / (float)0x1000000 * th;
+					runDroplet(heights, w, h, x, y, params, brush, radius);
+				}
+			});
+		}
+	}
+	return params.droplets;
+}
+
+// what neighbour n sends the centre c, in the order and with the max(x, 0) of _mm_max_ps
+static inline float thermalFlow(float c, float n, float limit) {
+	float in = n - c - limit, out = c - n - limit;
+	return (in > 0.0f ? in : 0.0f) - (out > 0.0f ? out : 0.0f);
+}
+
+// above and below are null past the map's first and last row, cells past its side columns send and take nothing
+static inline float thermalCell(const float* above, const float* row, const float* below, int x, bool left, bool right,
+	float talus, float talusDiagonal, float k)
+{
+	float c = row[x];
+	float sum = left ? thermalFlow(c, row[x - 1], talus) : 0.0f;
+	if (right) {
+		sum += thermalFlow(c, row[x + 1], talus);
+	}
+	if (above) {
+		sum += thermalFlow(c, above[x], talus);
+	}
+	if (below) {
+		sum += thermalFlow(c, below[x], talus);
+	}
+	if (above && left) {
+		sum += thermalFlow(c, above[x - 1], talusDiagonal);
+	}
+	if (above && right) {
+		sum += thermalFlow(c, above[x + 1], talusDiagonal);
+	}
+	if (below && left) {
+		sum += thermalFlow(c, below[x - 1], talusDiagonal);
+	}
+	if (below && right) {
+		sum += thermalFlow(c, below[x + 1], talusDiagonal);
+	}
+	return c + sum * k;
+}
+
+// cells [x0, x1) of a row width texels wide, the columns at 0 and width - 1 are the map's own edges
+static void thermalRow(const float* above, const float* row, const float* below, float* out, int x0, int x1, int width,
+	float talus, float talusDiagonal, float k)
+{
+	int x = x0;
+	if (x == 0 && x < x1) {
+		out[0] = thermalCell(above, row, below, 0, false, width > 1, talus, talusDiagonal, k);
+		x = 1;
+	}
+
+	// the kernels want all 8 neighbours
+	int inner = std::min(x1, width - 1);
+	if (above && below && x < inner) {
+		switch (simdLevel()) {
+		case SIMD_AVX2:
+			x += thermalRowAVX2(above + x, row + x, below + x, out + x, inner - x, talus, talusDiagonal, k);
+			break;
+		// SSE4.1 adds nothing for floats
+		case SIMD_SSE41:
+		case SIMD_SSE2:
+			x += thermalRowSSE2(above + x, row + x, below + x, out + x, inner - x, talus, talusDiagonal, k);
+			break;
+		default:
+			break;
+		}
+	}
+
+	for (; x < x1; x++) {
+		out[x] = thermalCell(above, row, below, x, x > 0, x < width - 1, talus, talusDiagonal, k);
+	}
+}
+
+/*
+	steps iterations of the tile at (x0, y0) in a local copy with a halo of
+	steps texels: the halo goes stale a texel per step from the outside in,
+	so the tile itself is exact at the end. Sides on the map's edge have no
+	halo and never go stale.
+*/
+static void thermalTile(const float* src, float* dst, int w, int h, int x0, int y0, int tw, int th, int steps,
+	float talus, float talusDiagonal, float k)
+{
+	int bx0 = std::max(0, x0 - steps), by0 = std::max(0, y0 - steps);
+	int bx1 = std::min(w, x0 + tw + steps), by1 = std::min(h, y0 + th + steps);
+	int lw = bx1 - bx0, lh = by1 - by0;
+
+	// reused across tiles on the same thread
+	thread_local std::vector<float> front, back;
+	front.resize((size_t)lw * lh);
+	back.resize((size_t)lw * lh);
+	for (int y = 0; y < lh; y++) {
+		memcpy(&front[(size_t)y * lw], src + (size_t)(by0 + y) * w + bx0, lw * sizeof(float));
+	}
+
+	float* current = front.data();
+	float* next = back.data();
+	for (int s = 1; s <= steps; s++) {
+		int cx0 = bx0 > 0 ? s : 0, cx1 = bx1 < w ? lw - s : lw;
+		int cy0 = by0 > 0 ? s : 0, cy1 = by1 < h ? lh - s : lh;
+		for (int y = cy0; y < cy1; y++) {
+			const float* row = current + (size_t)y * lw;
+			thermalRow(y > 0 ? row - lw : nullptr, row, y < lh - 1 ? row + lw : nullptr, next + (size_t)y * lw,
+				cx0, cx1, lw, talus, talusDiagonal, k);
+		}
+		std::swap(current, next);
+	}
+
+	for (int y = 0; y < th; y++) {
+		memcpy(dst + (size_t)(y0 + y) * w + x0, current + (size_t)(y0 - by0 + y) * lw + (x0 - bx0), tw * sizeof(float));
+	}
+}
+
+void erodeThermal(JobSystem& jobs, float* heights, int w, int h, const ThermalParams& params) {
+	if (w < 1 || h < 1 || params.iterations <= 0) {
+		return;
+	}
+
+	// slopes in normalized height per texel, diagonal neighbours are sqrt(2) texels away
+	float talus = std::max(0.0f, params.talus) / HEIGHT_SCALE;
+	float talusDiagonal = talus * std::sqrt(2.0f);
+	float k = std::clamp(params.rate, 0.0f, 1.0f) / 8.0f;
+	int blockSteps = std::max(1, std::min(params.blockSteps, THERMAL_TILE));
+
+	std::vector<float> other((size_t)w * h);
+	float* src = heights;
+	float* dst = other.data();
+	for (int done = 0; done < params.iterations;) {
+		int steps = std::min(blockSteps, params.iterations - done);
+		forEachTile(jobs, w, h, THERMAL_TILE, [&](int x0, int y0, int tw, int th) {
+			thermalTile(src, dst, w, h, x0, y0, tw, th, steps, talus, talusDiagonal, k);
+		});
+		std::swap(src, dst);
+		done += steps;
+	}
+	if (src != heights) {
+		memcpy(heights, src, (size_t)w * h * sizeof(float));
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+
+#include "job_system.hpp"
+
+/*
+	Particle erosion after Hans Theobald Beyer, "Implementation of a method
+	for hydraulic erosion" (2015). Every droplet starts with one unit of
+	water, runs downhill picking up sediment while it speeds up and drops it
+	where it slows down or climbs, for at most maxLifetime steps of one
+	texel. Lengths are in world units: texels one apart, heights
+	worldHeight() scaled.
+*/
+struct HydraulicParams {
+	int droplets = 250000;
+	uint32_t seed = 1337;
+	int maxLifetime = 30;      // steps, a droplet moves one texel per step
+	int radius = 3;            // texels around a droplet the brush erodes
+	float inertia = 0.05f;     // how much of its direction a droplet keeps over the slope's
+	float capacity = 4.0f;     // sediment carried per unit of drop, speed and water
+	float minSlope = 0.01f;    // keeps a droplet on flat ground carrying some sediment
+	float erosion = 0.3f;      // fraction of the free capacity taken from the ground per step
+	float deposition = 0.3f;   // fraction of the excess sediment dropped per step
+	float evaporation = 0.01f; // fraction of the water lost per step
+	float gravity = 4.0f;
+	int batches = 4;           // rounds over all tiles, so no tile is always eroded before its neighbours
+};
+
+/*
+	Erodes a w x h row-major buffer of normalized heights (the layout
+	generateHeightmap() fills) in place. Returns the droplets simulated.
+
+	The map is cut into tiles wider than twice the furthest a droplet can
+	reach, and the tiles run in four phases by the parity of their x and y
+	index. Tiles of one phase are a whole tile apart, so their droplets
+	never touch the same texel and run in parallel without locks. Each
+	droplet takes its start from a hash of the seed and its index, and a
+	tile runs its droplets in order, so the result is the same bits on any
+	number of threads.
+*/
+int erodeHydraulic(JobSystem& jobs, float* heights, int w, int h, const HydraulicParams& params = HydraulicParams());
+
+/*
+	Thermal weathering: material slips off any slope steeper than the talus
+	angle onto the neighbours below it, over the 8 neighbours of a texel.
+*/
+struct ThermalParams {
+	int iterations = 50;
+	float talus = 0.6f;   // steepest stable slope, world height per world unit (tan of the talus angle)
+	float rate = 0.5f;    // share of the excess over the talus slope moved per iteration, at most 1
+
+	/*
+		Iterations a tile runs while it sits in cache, with a halo as wide as
+		the count. 1 is a plain pass over the whole map per iteration; the
+		result is the same bits either way.
+	*/
+	int blockSteps = 8;
+};
+
+/*
+	Erodes a w x h row-major buffer of normalized heights in place.
+
+	Every iteration is a double-buffered stencil: a texel's new height
+	depends only on its neighbourhood in the previous one, and what it
+	gains from a neighbour is exactly what that neighbour loses, so the
+	total height stays put up to rounding. The rows run through SIMD
+	kernels picked by simdLevel(), bit-identical to the scalar path, and
+	tiles of the map run blockSteps iterations at a time on the job system.
+*/
+void erodeThermal(JobSystem& jobs, float* heights, int w, int h, const ThermalParams& params = ThermalParams());
@@ -0,0 +1,80 @@
+#include "erosion_simd.hpp"
+#include "simd.hpp"
+
+#ifdef TERRAIN_X86
+#include <immintrin.h>
+
+// what neighbour n sends the centre c, negative when the slope runs the other way
+TERRAIN_TARGET("sse2")
+static inline __m128 thermalFlowSSE2(__m128 c, __m128 n, __m128 limit) {
+	const __m128 zero = _mm_setzero_ps();
+	__m128 in = _mm_max_ps(_mm_sub_ps(_mm_sub_ps(n, c), limit), zero);
+	__m128 out = _mm_max_ps(_mm_sub_ps(_mm_sub_ps(c, n), limit), zero);
+	return _mm_sub_ps(in, out);
+}
+
+TERRAIN_TARGET("avx2")
+static inline __m256 thermalFlowAVX2(__m256 c, __m256 n, __m256 limit) {
+	const __m256 zero = _mm256_setzero_ps();
+	__m256 in = _mm256_max_ps(_mm256_sub_ps(_mm256_sub_ps(n, c), limit), zero);
+	__m256 out = _mm256_max_ps(_mm256_sub_ps(_mm256_sub_ps(c, n), limit), zero);
+	return _mm256_sub_ps(in, out);
+}
+
+TERRAIN_TARGET("sse2")
+int thermalRowSSE2(const float* above, const float* row, const float* below, float* out, int count,
+	float talus, float talusDiagonal, float k)
+{
+	const __m128 t = _mm_set1_ps(talus), td = _mm_set1_ps(talusDiagonal);
+	const __m128 scale = _mm_set1_ps(k);
+
+	int x = 0;
+	for (; x + 4 <= count; x += 4) {
+		__m128 c = _mm_loadu_ps(row + x);
+		__m128 sum = thermalFlowSSE2(c, _mm_loadu_ps(row + x - 1), t);
+		sum = _mm_add_ps(sum, thermalFlowSSE2(c, _mm_loadu_ps(row + x + 1), t));
+		sum = _mm_add_ps(sum, thermalFlowSSE2(c, _mm_loadu_ps(above + x), t));
+		sum = _mm_add_ps(sum, thermalFlowSSE2(c, _mm_loadu_ps(below + x), t));
+		sum = _mm_add_ps(sum, thermalFlowSSE2(c, _mm_loadu_ps(above + x - 1), td));
+		sum = _mm_add_ps(sum, thermalFlowSSE2(c, _mm_loadu_ps(above + x + 1), td));
+		sum = _mm_add_ps(sum, thermalFlowSSE2(c, _mm_loadu_ps(below + x - 1), td));
+		sum = _mm_add_ps(sum, thermalFlowSSE2(c, _mm_loadu_ps(below + x + 1), td));
+		_mm_storeu_ps(out + x, _mm_add_ps(c, _mm_mul_ps(sum, scale)));
+	}
+	return x;
+}
+
+TERRAIN_TARGET("avx2")
+int thermalRowAVX2(const float* above, const float* row, const float* below, float* out, int count,
+	float talus, float talusDiagonal, float k)
+{
+	const __m256 t = _mm256_set1_ps(talus), td = _mm256_set1_ps(talusDiagonal);
+	const __m256 scale = _mm256_set1_ps(k);
+
+	int x = 0;
+	for (; x + 8 <= count; x += 8) {
+		__m256 c = _mm256_loadu_ps(row + x);
+		__m256 sum = thermalFlowAVX2(c, _mm256_loadu_ps(row + x - 1), t);
+		sum = _mm256_add_ps(sum, thermalFlowAVX2(c, _mm256_loadu_ps(row + x + 1), t));
+		sum = _mm256_add_ps(sum, thermalFlowAVX2(c, _mm256_loadu_ps(above + x), t));
+		sum = _mm256_add_ps(sum, thermalFlowAVX2(c, _mm256_loadu_ps(below + x), t));
+		sum = _mm256_add_ps(sum, thermalFlowAVX2(c, _mm256_loadu_ps(above + x - 1), td));
+		sum = _mm256_add_ps(sum, thermalFlowAVX2(c, _mm256_loadu_ps(above + x + 1), td));
+		sum = _mm256_add_ps(sum, thermalFlowAVX2(c, _mm256_loadu_ps(below + x - 1), td));
+		sum = _mm256_add_ps(sum, thermalFlowAVX2(c, _mm256_loadu_ps(below + x + 1), td));
+		_mm256_storeu_ps(out + x, _mm256_add_ps(c, _mm256_mul_ps(sum, scale)));
+	}
+	return x;
+}
+
+#else
+
+// non-x86 builds only ever dispatch to the scalar path
+int thermalRowSSE2(const float*, const float*, const float*, float*, int, float, float, float) {
+	return 0;
+}
+int thermalRowAVX2(const float*, const float*, const float*, float*, int, float, float, float) {
+	return 0;
+}
+
+#endif
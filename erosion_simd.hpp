@@ -0,0 +1,20 @@
+#pragma once
+
+/*
+	Vectorized rows of the thermal erosion stencil. out[x] becomes row[x]
+	plus k times the flow from its 8 neighbours, for x in [0, count): each
+	neighbour n gives max(0, n - c - t) - max(0, c - n - t), with t the
+	talus for the orthogonal and the diagonal ones, summed left, right, up,
+	down, then the diagonals. The same float operations in the same order
+	as the scalar stencil (no FMA contraction), so the results are
+	bit-identical to it.
+
+	Every row is read from -1 to count inclusive. Only whole vectors are
+	done, the return value is how many cells that was; the caller does the
+	rest.
+*/
+
+int thermalRowSSE2(const float* above, const float* row, const float* below, float* out, int count,
+	float talus, float talusDiagonal, float k);
+int thermalRowAVX2(const float* above, const float* row, const float* below, float* out, int count,
+	float talus, float talusDiagonal, float k);
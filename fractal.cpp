@@ -0,0 +1,232 @@
+#include "fractal.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// largest magnitude PerlinNoise::noise can return with its gradient set
+static const float NOISE_BOUND = 1.0f;
+
+static inline float accumulate(FRACTAL_TYPE type, float n, float amplitude, float& weight) {
+	switch (type) {
+	case FRACTAL_RIDGED: {
+		float signal = 1.0f - std::fabs(n);
+		signal *= signal;
+		signal *= weight;
+		// sharp crests in one octave suppress detail in the valleys of the next
+		weight = std::clamp(signal * 2.0f, 0.0f, 1.0f);
+		return signal * amplitude;
+	}
+	case FRACTAL_BILLOW:
+		return (2.0f * std::fabs(n) - 1.0f) * amplitude;
+	default:
+		return n * amplitude;
+	}
+}
+
+static inline int quantize(float h, int levels) {
+	return (int)(std::clamp(h, 0.0f, 1.0f) * (float)levels + 0.5f);
+}
+
+FractalNoise::FractalNoise(const PerlinNoise& noise, const FractalParams& params)
+	: m_noise(noise), m_params(params)
+{
+	m_params.octaves = std::max(1, m_params.octaves);
+
+	uint32_t state = noise.seed() * 0x9E3779B9u + 0x7F4A7C15u;
+	auto nextOffset = [&state]() {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return (float)(state & 0xFFFF) / 256.0f;
+	};
+
+	float amplitude = 1.0f, frequency = 1.0f, sum = 0.0f;
+	for (int i = 0; i < m_params.octaves; i++) {
+		m_amplitude.push_back(amplitude);
+		m_frequency.push_back(frequency);
+		m_offset.push_back(i == 0 ? glm::vec2(0.0f) : glm::vec2(nextOffset(), nextOffset()));
+		sum += amplitude;
+		amplitude *= m_params.gain;
+		frequency *= m_params.lacunarity;
+	}
+	m_invAmplitudeSum = 1.0f / sum;
+
+	m_remaining.resize(m_params.octaves);
+	float rest = 0.0f;
+	for (int i = m_params.octaves - 1; i >= 0; i--) {
+		m_remaining[i] = rest * NOISE_BOUND;
+		rest += m_amplitude[i];
+	}
+
+	/*
+		A sample settles once its remaining range no longer straddles a step
+		boundary. Testing costs about as much as an octave of noise, so it
+		only starts once the range is under half a step and most samples
+		are expected to settle.
+	*/
+	m_firstSettleOctave = m_params.octaves;
+	if (m_params.quantizeLevels > 0) {
+		for (int i = 0; i < m_params.octaves; i++) {
+			if (m_remaining[i] * m_invAmplitudeSum < 0.5f / (float)m_params.quantizeLevels) {
+				m_firstSettleOctave = i;
+				break;
+			}
+		}
+	}
+}
+
+const FractalParams& FractalNoise::params() const {
+	return m_params;
+}
+
+float FractalNoise::normalize(float sum) const {
+	if (m_params.type == FRACTAL_RIDGED) {
+		return std::clamp(sum * m_invAmplitudeSum, 0.0f, 1.0f);
+	}
+	return std::clamp(sum * m_invAmplitudeSum * 0.5f + 0.5f, 0.0f, 1.0f);
+}
+
+float FractalNoise::sample(float x, float y) const {
+	float sum = 0.0f, weight = 1.0f;
+	// slack for the rounding of the partial sums
+	float slack = 1e-6f / m_invAmplitudeSum;
+
+	for (int i = 0; i < m_params.octaves; i++) {
+		float n = m_noise.noise(x * m_frequency[i] + m_offset[i].x, y * m_frequency[i] + m_offset[i].y);
+		sum += accumulate(m_params.type, n, m_amplitude[i], weight);
+
+		if (i >= m_firstSettleOctave && i + 1 < m_params.octaves) {
+			float rest = m_remaining[i] + slack;
+			float lo = m_params.type == FRACTAL_RIDGED ? sum : sum - rest;
+			if (quantize(normalize(lo), m_params.quantizeLevels) == quantize(normalize(sum + rest), m_params.quantizeLevels)) {
+				break;
+			}
+		}
+	}
+	return normalize(sum);
+}
+
+void FractalNoise::sample8(const float* x, const float* y, float* out) const {
+	float sum[8] = {}, weight[8] = { 1, 1, 1, 1, 1, 1, 1, 1 };
+	bool settled[8] = {};
+	float xs[8], ys[8], n[8];
+	float slack = 1e-6f / m_invAmplitudeSum;
+
+	for (int i = 0; i < m_params.octaves; i++) {
+		for (int k = 0; k < 8; k++) {
+			xs[k] = x[k] * m_frequency[i] + m_offset[i].x;
+			ys[k] = y[k] * m_frequency[i] + m_offset[i].y;
+		}
+		m_noise.noise8(xs, ys, n);
+
+		bool all = true;
+		for (int k = 0; k < 8; k++) {
+			if (settled[k]) {
+				continue;
+			}
+			sum[k] += accumulate(m_params.type, n[k], m_amplitude[i], weight[k]);
+
+			if (i >= m_firstSettleOctave && i + 1 < m_params.octaves) {
+				float rest = m_remaining[i] + slack;
+				float lo = m_params.type == FRACTAL_RIDGED ? sum[k] : sum[k] - rest;
+				settled[k] = quantize(normalize(lo), m_params.quantizeLevels) ==
+					quantize(normalize(sum[k] + rest), m_params.quantizeLevels);
+			}
+			all = all && settled[k];
+		}
+		if (all) {
+			break;
+		}
+	}
+
+	for (int k = 0; k < 8; k++) {
+		out[k] = normalize(sum[k]);
+	}
+}
+
+void FractalNoise::generate(float* out, int w, int h, glm::vec2 origin, float scale) const {
+	generateRegion(out, w, 0, 0, w, h, origin, scale);
+}
+
+void FractalNoise::generateRegion(float* out, int stride, int x0, int y0, int w, int h, glm::vec2 origin, float scale) const {
+	// per-row scratch in structure of arrays, reused across calls on the same worker thread
+	thread_local std::vector<float> sum, weight, px;
+	thread_local std::vector<int> column;
+	thread_local std::vector<unsigned char> unsettled;
+	sum.resize(w + 8);
+	weight.resize(w + 8);
+	px.resize(w + 8);
+	column.resize(w + 8);
+	unsettled.resize(w + 8);
+
+	float ys[8], n[8];
+	float slack = 1e-6f / m_invAmplitudeSum;
+	int levels = m_params.quantizeLevels;
+
+	for (int y = y0; y < y0 + h; y++) {
+		float sy = origin.y + (float)y * scale;
+		float* row = out + (size_t)y * stride + x0;
+
+		for (int x = 0; x < w + 8; x++) {
+			sum[x] = 0.0f;
+			weight[x] = 1.0f;
+			px[x] = origin.x + (float)(x0 + x) * scale;
+			column[x] = x;
+		}
+		int count = w;
+
+		/*
+			Octave by octave over the samples that are still unsettled. A
+			settled sample is written out and compacted away, so the remaining
+			octaves run in full groups of 8 over only the samples that need them.
+		*/
+		for (int i = 0; i < m_params.octaves && count > 0; i++) {
+			float frequency = m_frequency[i];
+			float yo = sy * frequency + m_offset[i].y;
+			for (int k = 0; k < 8; k++) {
+				ys[k] = yo;
+			}
+
+			// the lanes past count belong to the padding and are ignored
+			for (int j = 0; j < count; j += 8) {
+				float xs[8];
+				for (int k = 0; k < 8; k++) {
+					xs[k] = px[j + k] * frequency + m_offset[i].x;
+				}
+				m_noise.noise8(xs, ys, n);
+				for (int k = 0; k < 8; k++) {
+					sum[j + k] += accumulate(m_params.type, n[k], m_amplitude[i], weight[j + k]);
+				}
+			}
+
+			if (i < m_firstSettleOctave || i + 1 == m_params.octaves) {
+				continue;
+			}
+
+			float rest = m_remaining[i] + slack;
+			float below = m_params.type == FRACTAL_RIDGED ? 0.0f : rest;
+			for (int j = 0; j < count; j++) {
+				unsettled[j] = quantize(normalize(sum[j] - below), levels) != quantize(normalize(sum[j] + rest), levels);
+			}
+
+			int kept = 0;
+			for (int j = 0; j < count; j++) {
+				if (unsettled[j]) {
+					sum[kept] = sum[j];
+					weight[kept] = weight[j];
+					px[kept] = px[j];
+					column[kept] = column[j];
+					kept++;
+				}
+				else {
+					row[column[j]] = normalize(sum[j]);
+				}
+			}
+			count = kept;
+		}
+
+		for (int j = 0; j < count; j++) {
+			row[column[j]] = normalize(sum[j]);
+		}
+	}
+}
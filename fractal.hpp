@@ -0,0 +1,61 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "noise.hpp"
+
+enum FRACTAL_TYPE {
+	FRACTAL_FBM,    // sum of signed octaves
+	FRACTAL_RIDGED, // Musgrave ridged multifractal, sharp crests
+	FRACTAL_BILLOW  // sum of |noise| octaves, rounded hills
+};
+
+struct FractalParams {
+	FRACTAL_TYPE type = FRACTAL_FBM;
+	int octaves = 8;
+	float lacunarity = 2.0f; // frequency multiplier between octaves
+	float gain = 0.5f;       // amplitude multiplier between octaves
+
+	/*
+		Number of steps the output is quantized to afterwards (65535 for
+		R16), 0 to always evaluate every octave. When set, a sample stops
+		adding octaves as soon as the amplitude left in the remaining ones
+		can no longer move it to another quantization step, so the quantized
+		result is the same as with every octave evaluated.
+	*/
+	int quantizeLevels = 0;
+};
+
+/*
+	Multi-octave composer on top of PerlinNoise. Rows are generated octave
+	by octave through PerlinNoise::noise8; with quantizeLevels set, samples
+	that have settled drop out of the row before the next octave.
+*/
+class FractalNoise {
+private:
+	PerlinNoise m_noise;
+	FractalParams m_params;
+	std::vector<float> m_amplitude;
+	std::vector<float> m_frequency;
+	std::vector<glm::vec2> m_offset;  // decorrelates the octaves, which would otherwise all line up at the origin
+	std::vector<float> m_remaining;   // amplitude still to come after each octave
+	float m_invAmplitudeSum = 1.0f;
+	int m_firstSettleOctave = 0;      // before it the remaining amplitude spans more than one quantization step
+
+	float normalize(float sum) const;
+public:
+	FractalNoise(const PerlinNoise& noise, const FractalParams& params);
+
+	const FractalParams& params() const;
+
+	// height in [0, 1] at noise space position (x, y)
+	float sample(float x, float y) const;
+
+	// sample() for 8 positions at once, bit-identical to 8 sample() calls
+	void sample8(const float* x, const float* y, float* out) const;
+
+	// same contract as PerlinNoise::generate / generateRegion
+	void generate(float* out, int w, int h, glm::vec2 origin, float scale) const;
+	void generateRegion(float* out, int stride, int x0, int y0, int w, int h, glm::vec2 origin, float scale) const;
+};
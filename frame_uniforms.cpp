@@ -0,0 +1,52 @@
+#include "frame_uniforms.hpp"
+
+FrameUniforms::FrameUniforms() {
+	glGenBuffers(1, &m_buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameConstants), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORM_BINDING, m_buffer);
+}
+
+FrameUniforms::~FrameUniforms() {
+	glDeleteBuffers(1, &m_buffer);
+}
+
+void FrameUniforms::setViewport(int width, int height) {
+	m_constants.viewportSize = glm::vec2((float)width, (float)height);
+}
+
+void FrameUniforms::setTrianglesPerPixel(float trianglesPerPixel) {
+	m_constants.trianglesPerPixel = trianglesPerPixel;
+}
+
+void FrameUniforms::update(const glm::mat4& projection, const glm::mat4& view, const glm::mat4& model) {
+	m_constants.projection = projection;
+	m_constants.view = view;
+	m_constants.model = model;
+	m_constants.viewProjection = projection * view;
+	m_constants.modelView = view * model;
+	m_constants.modelViewProjection = projection * m_constants.modelView;
+
+	// Gribb/Hartmann: each clip plane is the last row of the matrix plus or minus one of the others
+	const glm::mat4& m = m_constants.modelViewProjection;
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++) {
+		rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+	}
+	for (int i = 0; i < 3; i++) {
+		m_constants.frustumPlanes[i * 2] = rows[3] + rows[i];
+		m_constants.frustumPlanes[i * 2 + 1] = rows[3] - rows[i];
+	}
+	for (glm::vec4& plane : m_constants.frustumPlanes) {
+		plane /= glm::length(glm::vec3(plane));
+	}
+
+	glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameConstants), &m_constants);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+const FrameConstants& FrameUniforms::constants() const {
+	return m_constants;
+}
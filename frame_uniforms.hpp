@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// binding point of the FrameConstants block, the shaders declare it with layout (std140, binding = 0)
+static const GLuint FRAME_UNIFORM_BINDING = 0;
+
+/*
+	Mirror of the std140 FrameConstants block. The members are mat4s,
+	vec4s and a vec2 and two floats filling the last 16 bytes, which std140
+	packs without padding, so the struct can be copied as is.
+*/
+struct FrameConstants {
+	glm::mat4 projection;
+	glm::mat4 view;
+	glm::mat4 model;
+	glm::mat4 viewProjection;
+	glm::mat4 modelView;           // used by the tessellation control stage for distances
+	glm::mat4 modelViewProjection; // used by the tessellation evaluation stage for clip space
+	glm::vec4 frustumPlanes[6];    // model space, xyz inward normal and w distance, for culling patches
+	glm::vec2 viewportSize = glm::vec2(1.0f); // pixels
+	float trianglesPerPixel = 0.1f; // tessellation target on screen
+	float padding = 0.0f;
+};
+
+/*
+	Per-frame matrices in one uniform buffer bound to FRAME_UNIFORM_BINDING,
+	shared by every program that declares the block. The products are done
+	once on the CPU instead of per patch and per vertex on the GPU.
+*/
+class FrameUniforms {
+private:
+	GLuint m_buffer = 0;
+	FrameConstants m_constants;
+public:
+	FrameUniforms();
+	~FrameUniforms();
+
+	FrameUniforms(const FrameUniforms&) = delete;
+	FrameUniforms& operator=(const FrameUniforms&) = delete;
+
+	// both are uploaded by the next update()
+	void setViewport(int width, int height);
+	void setTrianglesPerPixel(float trianglesPerPixel);
+
+	// once per frame, fills in the products and uploads the block
+	void update(const glm::mat4& projection, const glm::mat4& view, const glm::mat4& model);
+
+	const FrameConstants& constants() const;
+};
@@ -1,75 +1,144 @@
 #pragma once
 
 #include <glad/glad.h>
-#include <glfw/glfw3.h>
 #include <glm/glm.hpp>
+#include <cstddef>
+#include <span>
 #include <vector>
 
-using glm::vec3, std::vector;
+/*
+	Flat grids for plain vertex and index buffers. The write* generators
+	fill caller-provided spans (a std::vector, or a buffer mapped with
+	glMapBufferRange) with exactly planeVertexCount() vertices and
+	planeIndexCount() indices. Nothing is allocated, and the spans must
+	hold at least that much; a span that is too small makes them return
+	false without writing. The vector-returning versions size their
+	result exactly once.
 
-vector<GLfloat> line(vec3 start, vec3 end, int div) {
-	vec3 direction = (end - start) / (float)div;
-	std::vector<GLfloat> vertices;
-	vertices.reserve(div * 3);
+	Indices are GLuint, so div can go up to 65534.
+*/
+
+// (div + 1) points from start to end, xyz each
+inline std::vector<GLfloat> line(glm::vec3 start, glm::vec3 end, int div) {
+	glm::vec3 direction = (end - start) / (float)div;
+	std::vector<GLfloat> vertices((size_t)(div + 1) * 3);
 	for (int i = 0; i <= div; i++) {
-		vec3 current = start + direction * (float)i;
+		glm::vec3 current = start + direction * (float)i;
 
-		vertices.emplace_back(current.x);
-		vertices.emplace_back(current.y);
-		vertices.emplace_back(current.z);
+		vertices[(size_t)i * 3] = current.x;
+		vertices[(size_t)i * 3 + 1] = current.y;
+		vertices[(size_t)i * 3 + 2] = current.z;
 	}
 	return vertices;
 }
 
-// 
+inline size_t planeVertexCount(int div) {
+	return (size_t)(div + 1) * (div + 1);
+}
 
-vector<GLfloat> plane(vec3 v0, vec3 v1, vec3 v2, vec3 v3, int div) {
-	vector<GLfloat> plane_vertices;
-	plane_vertices.reserve(2 * div);// completely arbitrary
+inline size_t planeIndexCount(int div) {
+	return (size_t)div * div * 6;
+}
 
-	/*  v3 --- v2
-		|      |
-		|      |
-		v0 --- v1
-	*/
+/*	v3 --- v2
+	|      |
+	|      |
+	v0 --- v1
 
-	vec3 basis_x = (v3 - v0) / (float)div;
-	vec3 basis_y = (v2 - v1) / (float)div;
+	Row i of the grid runs from v0 + (v3 - v0) * i / div to
+	v1 + (v2 - v1) * i / div, and vertex (i, j) is at i * (div + 1) + j.
+	fn(index, position) is called for every vertex in that order.
+*/
+template<class Fn>
+inline void forEachPlaneVertex(glm::vec3 v0, glm::vec3 v1, glm::vec3 v2, glm::vec3 v3, int div, Fn&& fn) {
+	glm::vec3 basisX = (v3 - v0) / (float)div;
+	glm::vec3 basisY = (v2 - v1) / (float)div;
 
+	size_t index = 0;
 	for (int i = 0; i <= div; i++) {
-		vec3 start = v0 + basis_x * (float)i;
-		vec3 end = v1 + basis_y * (float)i;
-		vector<GLfloat> _line = line(start, end, div);
-		for (GLfloat const v : _line) {
-			plane_vertices.emplace_back(v);
+		glm::vec3 start = v0 + basisX * (float)i;
+		glm::vec3 end = v1 + basisY * (float)i;
+		glm::vec3 direction = (end - start) / (float)div;
+		for (int j = 0; j <= div; j++) {
+			fn(index++, start + direction * (float)j);
 		}
 	}
-	return plane_vertices;
 }
 
-vector<GLuint> planeIndices(int div) {
-	/*  i + div +1 --- i + div + 1 + 1
-		|   /        |
-		| /          |
-		i --------- i+1
-	*/
-	vector<GLuint> indices;
-	indices.reserve(6 * div);
+// interleaved xyz, 3 * planeVertexCount(div) floats
+inline bool writePlane(std::span<GLfloat> out, glm::vec3 v0, glm::vec3 v1, glm::vec3 v2, glm::vec3 v3, int div) {
+	if (out.size() < planeVertexCount(div) * 3) {
+		return false;
+	}
+
+	GLfloat* vertices = out.data();
+	forEachPlaneVertex(v0, v1, v2, v3, div, [vertices](size_t index, glm::vec3 p) {
+		vertices[index * 3] = p.x;
+		vertices[index * 3 + 1] = p.y;
+		vertices[index * 3 + 2] = p.z;
+	});
+	return true;
+}
+
+// one array per component, planeVertexCount(div) floats each
+inline bool writePlane(std::span<GLfloat> x, std::span<GLfloat> y, std::span<GLfloat> z,
+	glm::vec3 v0, glm::vec3 v1, glm::vec3 v2, glm::vec3 v3, int div)
+{
+	size_t count = planeVertexCount(div);
+	if (x.size() < count || y.size() < count || z.size() < count) {
+		return false;
+	}
+
+	GLfloat* xs = x.data();
+	GLfloat* ys = y.data();
+	GLfloat* zs = z.data();
+	forEachPlaneVertex(v0, v1, v2, v3, div, [xs, ys, zs](size_t index, glm::vec3 p) {
+		xs[index] = p.x;
+		ys[index] = p.y;
+		zs[index] = p.z;
+	});
+	return true;
+}
+
+/*	i + div + 1 --- i + div + 1 + 1
+	|   /           |
+	| /             |
+	i ------------- i + 1
 
+	Two counter-clockwise triangles per quad, planeIndexCount(div) indices.
+*/
+inline bool writePlaneIndices(std::span<GLuint> out, int div) {
+	if (out.size() < planeIndexCount(div)) {
+		return false;
+	}
+
+	GLuint* indices = out.data();
+	GLuint row = (GLuint)div + 1;
 	for (int i = 0; i < div; i++) {
 		for (int j = 0; j < div; j++) {
-			int index = i * (div + 1) + j;
+			GLuint index = (GLuint)i * row + (GLuint)j;
 			// Top triangle
-			indices.emplace_back(index);
-			indices.emplace_back(index + div + 1 + 1);
-			indices.emplace_back(index + div + 1);
+			indices[0] = index;
+			indices[1] = index + row + 1;
+			indices[2] = index + row;
 			// Bottom Triangle
-			indices.emplace_back(index);
-			indices.emplace_back(index + 1);
-			indices.emplace_back(index + div + 1 + 1);
+			indices[3] = index;
+			indices[4] = index + 1;
+			indices[5] = index + row + 1;
+			indices += 6;
 		}
 	}
+	return true;
+}
 
-	return indices;
+inline std::vector<GLfloat> plane(glm::vec3 v0, glm::vec3 v1, glm::vec3 v2, glm::vec3 v3, int div) {
+	std::vector<GLfloat> vertices(planeVertexCount(div) * 3);
+	writePlane(vertices, v0, v1, v2, v3, div);
+	return vertices;
 }
 
+inline std::vector<GLuint> planeIndices(int div) {
+	std::vector<GLuint> indices(planeIndexCount(div));
+	writePlaneIndices(indices, div);
+	return indices;
+}
@@ -0,0 +1,323 @@
+#include "height_pyramid.hpp"
+#include "height_pyramid_simd.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+static void columnMinMax(const uint16_t* const* rows, int rowCount, int width, uint16_t* lo, uint16_t* hi) {
+	switch (simdLevel()) {
+	case SIMD_AVX2:
+		columnMinMaxR16AVX2(rows, rowCount, width, lo, hi);
+		break;
+	case SIMD_SSE41:
+		columnMinMaxR16SSE41(rows, rowCount, width, lo, hi);
+		break;
+	case SIMD_SSE2:
+		columnMinMaxR16SSE2(rows, rowCount, width, lo, hi);
+		break;
+	default:
+		for (int x = 0; x < width; x++) {
+			lo[x] = hi[x] = rows[0][x];
+			for (int r = 1; r < rowCount; r++) {
+				lo[x] = std::min(lo[x], rows[r][x]);
+				hi[x] = std::max(hi[x], rows[r][x]);
+			}
+		}
+		break;
+	}
+}
+
+static void columnMinMax(const float* const* rows, int rowCount, int width, float* lo, float* hi) {
+	switch (simdLevel()) {
+	case SIMD_AVX2:
+		columnMinMaxF32AVX2(rows, rowCount, width, lo, hi);
+		break;
+	// SSE4.1 adds nothing for floats
+	case SIMD_SSE41:
+	case SIMD_SSE2:
+		columnMinMaxF32SSE2(rows, rowCount, width, lo, hi);
+		break;
+	default:
+		for (int x = 0; x < width; x++) {
+			lo[x] = hi[x] = rows[0][x];
+			for (int r = 1; r < rowCount; r++) {
+				lo[x] = std::min(lo[x], rows[r][x]);
+				hi[x] = std::max(hi[x], rows[r][x]);
+			}
+		}
+		break;
+	}
+}
+
+// R32F heights to R16 steps, rounded outwards so the bounds stay conservative
+static inline uint16_t lowerStep(float h) {
+	return (uint16_t)std::floor(std::clamp((double)h, 0.0, 1.0) * 65535.0);
+}
+
+static inline uint16_t upperStep(float h) {
+	return (uint16_t)std::ceil(std::clamp((double)h, 0.0, 1.0) * 65535.0);
+}
+
+void HeightPyramid::build(const Heightmap& map) {
+	m_width = map.width();
+	m_height = map.height();
+	m_cellsX = std::max(1, m_width - 1);
+	m_cellsY = std::max(1, m_height - 1);
+
+	m_levels.clear();
+	int w = (m_cellsX + LEAF_CELLS - 1) / LEAF_CELLS;
+	int h = (m_cellsY + LEAF_CELLS - 1) / LEAF_CELLS;
+	while (true) {
+		Level level;
+		level.width = w;
+		level.height = h;
+		level.nodes.resize((size_t)w * h * 2);
+		m_levels.push_back(std::move(level));
+		if (w == 1 && h == 1) {
+			break;
+		}
+		w = std::max(1, w / 2);
+		h = std::max(1, h / 2);
+	}
+	m_dirty.assign(m_levels.size(), glm::ivec4(0));
+
+	buildLeaves(map, 0, 0, m_levels[0].width, m_levels[0].height);
+	markDirty(0, 0, 0, m_levels[0].width, m_levels[0].height);
+	for (int l = 1; l < levelCount(); l++) {
+		buildParents(l, 0, 0, m_levels[l].width, m_levels[l].height);
+		markDirty(l, 0, 0, m_levels[l].width, m_levels[l].height);
+	}
+}
+
+void HeightPyramid::update(const Heightmap& map, int x, int y, int width, int height) {
+	if (empty() || map.width() != m_width || map.height() != m_height) {
+		build(map);
+		return;
+	}
+
+	int x1 = std::min(x + width, m_width), y1 = std::min(y + height, m_height);
+	x = std::max(x, 0);
+	y = std::max(y, 0);
+	if (x >= x1 || y >= y1) {
+		return;
+	}
+
+	// a texel is a corner of the cells on both of its sides
+	glm::ivec2 first = nodeAt(0, x - 1, y - 1);
+	glm::ivec2 last = nodeAt(0, x1 - 1, y1 - 1);
+	int nx0 = first.x, ny0 = first.y, nx1 = last.x + 1, ny1 = last.y + 1;
+
+	buildLeaves(map, nx0, ny0, nx1, ny1);
+	markDirty(0, nx0, ny0, nx1, ny1);
+	for (int l = 1; l < levelCount(); l++) {
+		const Level& level = m_levels[l];
+		nx0 = std::min(nx0 / 2, level.width - 1);
+		ny0 = std::min(ny0 / 2, level.height - 1);
+		nx1 = std::min((nx1 - 1) / 2, level.width - 1) + 1;
+		ny1 = std::min((ny1 - 1) / 2, level.height - 1) + 1;
+		buildParents(l, nx0, ny0, nx1, ny1);
+		markDirty(l, nx0, ny0, nx1, ny1);
+	}
+}
+
+void HeightPyramid::buildLeaves(const Heightmap& map, int x0, int y0, int x1, int y1) {
+	Level& leaves = m_levels[0];
+
+	// texels under the leaves [x0, x1), border texels included
+	int tx0 = x0 * LEAF_CELLS;
+	int tx1 = std::min(x1 == leaves.width ? m_cellsX : x1 * LEAF_CELLS, m_width - 1);
+	int columns = tx1 - tx0 + 1;
+
+	// column results of one row of leaves, reused across calls on the same thread
+	thread_local std::vector<uint16_t> lo16, hi16;
+	thread_local std::vector<float> lo32, hi32;
+	bool r16 = map.format() == HEIGHT_R16;
+	if (r16) {
+		lo16.resize(columns);
+		hi16.resize(columns);
+	}
+	else {
+		lo32.resize(columns);
+		hi32.resize(columns);
+	}
+
+	for (int ly = y0; ly < y1; ly++) {
+		int ty0 = ly * LEAF_CELLS;
+		int ty1 = std::min(ly == leaves.height - 1 ? m_cellsY : (ly + 1) * LEAF_CELLS, m_height - 1);
+		int rowCount = ty1 - ty0 + 1;
+
+		// every leaf row spans LEAF_CELLS + 1 texel rows at most
+		if (r16) {
+			const uint16_t* rows[LEAF_CELLS + 1];
+			for (int r = 0; r < rowCount; r++) {
+				rows[r] = (const uint16_t*)map.data() + (size_t)(ty0 + r) * m_width + tx0;
+			}
+			columnMinMax(rows, rowCount, columns, lo16.data(), hi16.data());
+		}
+		else {
+			const float* rows[LEAF_CELLS + 1];
+			for (int r = 0; r < rowCount; r++) {
+				rows[r] = (const float*)map.data() + (size_t)(ty0 + r) * m_width + tx0;
+			}
+			columnMinMax(rows, rowCount, columns, lo32.data(), hi32.data());
+		}
+
+		for (int lx = x0; lx < x1; lx++) {
+			int c0 = lx * LEAF_CELLS - tx0;
+			int c1 = std::min(lx == leaves.width - 1 ? m_cellsX : (lx + 1) * LEAF_CELLS, m_width - 1) - tx0;
+
+			uint16_t mn, mx;
+			if (r16) {
+				mn = *std::min_element(lo16.begin() + c0, lo16.begin() + c1 + 1);
+				mx = *std::max_element(hi16.begin() + c0, hi16.begin() + c1 + 1);
+			}
+			else {
+				mn = lowerStep(*std::min_element(lo32.begin() + c0, lo32.begin() + c1 + 1));
+				mx = upperStep(*std::max_element(hi32.begin() + c0, hi32.begin() + c1 + 1));
+			}
+
+			uint16_t* node = &leaves.nodes[((size_t)ly * leaves.width + lx) * 2];
+			node[0] = mn;
+			node[1] = mx;
+		}
+	}
+}
+
+void HeightPyramid::buildParents(int level, int x0, int y0, int x1, int y1) {
+	Level& parents = m_levels[level];
+	const Level& children = m_levels[level - 1];
+
+	for (int y = y0; y < y1; y++) {
+		// the last parent takes the odd child out
+		int cy0 = y * 2;
+		int cy1 = y == parents.height - 1 ? children.height : cy0 + 2;
+
+		for (int x = x0; x < x1; x++) {
+			int cx0 = x * 2;
+			int cx1 = x == parents.width - 1 ? children.width : cx0 + 2;
+
+			uint16_t mn = 0xFFFF, mx = 0;
+			for (int cy = cy0; cy < cy1; cy++) {
+				const uint16_t* child = &children.nodes[((size_t)cy * children.width + cx0) * 2];
+				for (int cx = cx0; cx < cx1; cx++, child += 2) {
+					mn = std::min(mn, child[0]);
+					mx = std::max(mx, child[1]);
+				}
+			}
+
+			uint16_t* node = &parents.nodes[((size_t)y * parents.width + x) * 2];
+			node[0] = mn;
+			node[1] = mx;
+		}
+	}
+}
+
+void HeightPyramid::markDirty(int level, int x0, int y0, int x1, int y1) {
+	glm::ivec4& dirty = m_dirty[level];
+	if (dirty.x == dirty.z) {
+		dirty = glm::ivec4(x0, y0, x1, y1);
+	}
+	else {
+		dirty = glm::ivec4(std::min(dirty.x, x0), std::min(dirty.y, y0), std::max(dirty.z, x1), std::max(dirty.w, y1));
+	}
+}
+
+bool HeightPyramid::empty() const {
+	return m_levels.empty();
+}
+
+int HeightPyramid::levelCount() const {
+	return (int)m_levels.size();
+}
+
+int HeightPyramid::levelWidth(int level) const {
+	return m_levels[level].width;
+}
+
+int HeightPyramid::levelHeight(int level) const {
+	return m_levels[level].height;
+}
+
+const uint16_t* HeightPyramid::levelData(int level) const {
+	return m_levels[level].nodes.data();
+}
+
+int HeightPyramid::width() const {
+	return m_width;
+}
+
+int HeightPyramid::height() const {
+	return m_height;
+}
+
+int HeightPyramid::cellsX() const {
+	return m_cellsX;
+}
+
+int HeightPyramid::cellsY() const {
+	return m_cellsY;
+}
+
+glm::ivec4 HeightPyramid::nodeCells(int level, int x, int y) const {
+	const Level& l = m_levels[level];
+	int size = LEAF_CELLS << level;
+	return glm::ivec4(x * size, y * size,
+		x == l.width - 1 ? m_cellsX : (x + 1) * size,
+		y == l.height - 1 ? m_cellsY : (y + 1) * size);
+}
+
+glm::ivec2 HeightPyramid::nodeAt(int level, int cellX, int cellY) const {
+	const Level& l = m_levels[level];
+	int size = LEAF_CELLS << level;
+	return glm::ivec2(std::clamp(cellX / size, 0, l.width - 1), std::clamp(cellY / size, 0, l.height - 1));
+}
+
+glm::vec2 HeightPyramid::node(int level, int x, int y) const {
+	const Level& l = m_levels[level];
+	const uint16_t* n = &l.nodes[((size_t)y * l.width + x) * 2];
+	return glm::vec2((float)n[0], (float)n[1]) / 65535.0f;
+}
+
+glm::vec2 HeightPyramid::range(int x0, int y0, int x1, int y1) const {
+	x0 = std::clamp(x0, 0, m_cellsX - 1);
+	y0 = std::clamp(y0, 0, m_cellsY - 1);
+	x1 = std::clamp(x1, x0 + 1, m_cellsX);
+	y1 = std::clamp(y1, y0 + 1, m_cellsY);
+
+	// finest level where the rectangle falls into at most 4 x 4 nodes
+	int level = 0;
+	glm::ivec2 first(0), last(0);
+	for (; level < levelCount(); level++) {
+		first = nodeAt(level, x0, y0);
+		last = nodeAt(level, x1 - 1, y1 - 1);
+		if (last.x - first.x <= 3 && last.y - first.y <= 3) {
+			break;
+		}
+	}
+
+	glm::vec2 result(1.0f, 0.0f);
+	for (int y = first.y; y <= last.y; y++) {
+		for (int x = first.x; x <= last.x; x++) {
+			glm::vec2 n = node(level, x, y);
+			result = glm::vec2(std::min(result.x, n.x), std::max(result.y, n.y));
+		}
+	}
+	return result;
+}
+
+glm::ivec4 HeightPyramid::dirty(int level) const {
+	return m_dirty[level];
+}
+
+void HeightPyramid::clearDirty() {
+	std::fill(m_dirty.begin(), m_dirty.end(), glm::ivec4(0));
+}
+
+size_t HeightPyramid::sizeBytes() const {
+	size_t bytes = 0;
+	for (const Level& level : m_levels) {
+		bytes += level.nodes.size() * sizeof(uint16_t);
+	}
+	return bytes;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "heightmap.hpp"
+
+/*
+	Min/max mip chain over the cells of a heightmap, the squares between
+	four neighbouring texels, for culling, picking, collision and LOD error
+	estimates.
+
+	A level 0 node covers LEAF_CELLS x LEAF_CELLS cells (the texels on
+	their border included) and every level halves the node count, rounded
+	down like GL mip sizes, so the chain uploads 1:1 into a GL_RG16 texture
+	(HeightPyramidTexture). Where a level has an odd node count the last
+	node of the next one takes the extra child, node x at level l covers
+	cells [x * size, (x + 1) * size) with size = LEAF_CELLS << l, except the
+	last one which runs to the edge of the map.
+
+	Nodes store (min, max) as normalized 16 bit pairs, rounded outwards for
+	R32F maps, so bounds are conservative for anything bilinear filtering
+	of the heightmap returns. The whole chain takes about width * height / 3
+	bytes: a sixth of an R16 heightmap, a twelfth of an R32F one.
+*/
+class HeightPyramid {
+private:
+	struct Level {
+		int width = 0;
+		int height = 0;
+		std::vector<uint16_t> nodes; // min, max pairs, row-major
+	};
+
+	int m_width = 0;  // heightmap texels
+	int m_height = 0;
+	int m_cellsX = 0;
+	int m_cellsY = 0;
+	std::vector<Level> m_levels;
+	std::vector<glm::ivec4> m_dirty; // per level x0, y0, x1, y1 of the nodes changed, x0 == x1 when clean
+
+	void buildLeaves(const Heightmap& map, int x0, int y0, int x1, int y1);
+	void buildParents(int level, int x0, int y0, int x1, int y1);
+	void markDirty(int level, int x0, int y0, int x1, int y1);
+public:
+	static const int LEAF_CELLS = 4;
+
+	// rebuilds the whole chain
+	void build(const Heightmap& map);
+
+	/*
+		Rebuilds the nodes over the texels [x, x + width) x [y, y + height)
+		after the heightmap changed there (a tile, an erosion brush), the map
+		must keep its size. Only the leaves touching the rectangle and their
+		ancestors are recomputed.
+	*/
+	void update(const Heightmap& map, int x, int y, int width, int height);
+
+	bool empty() const;
+	int levelCount() const;
+	int levelWidth(int level) const;
+	int levelHeight(int level) const;
+
+	// width * height (min, max) pairs, ready for glTexSubImage2D(..., GL_RG, GL_UNSIGNED_SHORT, ...)
+	const uint16_t* levelData(int level) const;
+
+	// texels of the heightmap the chain was built from
+	int width() const;
+	int height() const;
+
+	// cells of the heightmap
+	int cellsX() const;
+	int cellsY() const;
+
+	// cells [x, z) x [y, w) covered by a node
+	glm::ivec4 nodeCells(int level, int x, int y) const;
+
+	// node containing a cell
+	glm::ivec2 nodeAt(int level, int cellX, int cellY) const;
+
+	// normalized (min, max) of a node
+	glm::vec2 node(int level, int x, int y) const;
+
+	/*
+		Normalized (min, max) over the cells [x0, x1) x [y0, y1), clamped to
+		the map. Read from at most 4 x 4 nodes of the finest level where the
+		rectangle fits in that many, so it can be looser than the exact range
+		but never tighter.
+	*/
+	glm::vec2 range(int x0, int y0, int x1, int y1) const;
+
+	// nodes changed by build() or update() since clearDirty(), for uploading only those
+	glm::ivec4 dirty(int level) const;
+	void clearDirty();
+
+	size_t sizeBytes() const;
+};
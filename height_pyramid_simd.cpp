@@ -0,0 +1,114 @@
+#include "height_pyramid_simd.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+
+template <typename T>
+static inline void columnMinMaxTail(const T* const* rows, int rowCount, int x, int width, T* lo, T* hi) {
+	for (; x < width; x++) {
+		T mn = rows[0][x], mx = rows[0][x];
+		for (int r = 1; r < rowCount; r++) {
+			mn = std::min(mn, rows[r][x]);
+			mx = std::max(mx, rows[r][x]);
+		}
+		lo[x] = mn;
+		hi[x] = mx;
+	}
+}
+
+#ifdef TERRAIN_X86
+#include <immintrin.h>
+
+// no unsigned 16 bit min/max before SSE4.1, flipping the sign bit maps the order onto the signed one
+TERRAIN_TARGET("sse2")
+void columnMinMaxR16SSE2(const uint16_t* const* rows, int rowCount, int width, uint16_t* lo, uint16_t* hi) {
+	const __m128i bias = _mm_set1_epi16((short)0x8000);
+	int x = 0;
+	for (; x + 8 <= width; x += 8) {
+		__m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(rows[0] + x)), bias);
+		__m128i mn = v, mx = v;
+		for (int r = 1; r < rowCount; r++) {
+			v = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(rows[r] + x)), bias);
+			mn = _mm_min_epi16(mn, v);
+			mx = _mm_max_epi16(mx, v);
+		}
+		_mm_storeu_si128((__m128i*)(lo + x), _mm_xor_si128(mn, bias));
+		_mm_storeu_si128((__m128i*)(hi + x), _mm_xor_si128(mx, bias));
+	}
+	columnMinMaxTail(rows, rowCount, x, width, lo, hi);
+}
+
+TERRAIN_TARGET("sse4.1")
+void columnMinMaxR16SSE41(const uint16_t* const* rows, int rowCount, int width, uint16_t* lo, uint16_t* hi) {
+	int x = 0;
+	for (; x + 8 <= width; x += 8) {
+		__m128i mn = _mm_loadu_si128((const __m128i*)(rows[0] + x)), mx = mn;
+		for (int r = 1; r < rowCount; r++) {
+			__m128i v = _mm_loadu_si128((const __m128i*)(rows[r] + x));
+			mn = _mm_min_epu16(mn, v);
+			mx = _mm_max_epu16(mx, v);
+		}
+		_mm_storeu_si128((__m128i*)(lo + x), mn);
+		_mm_storeu_si128((__m128i*)(hi + x), mx);
+	}
+	columnMinMaxTail(rows, rowCount, x, width, lo, hi);
+}
+
+TERRAIN_TARGET("avx2")
+void columnMinMaxR16AVX2(const uint16_t* const* rows, int rowCount, int width, uint16_t* lo, uint16_t* hi) {
+	int x = 0;
+	for (; x + 16 <= width; x += 16) {
+		__m256i mn = _mm256_loadu_si256((const __m256i*)(rows[0] + x)), mx = mn;
+		for (int r = 1; r < rowCount; r++) {
+			__m256i v = _mm256_loadu_si256((const __m256i*)(rows[r] + x));
+			mn = _mm256_min_epu16(mn, v);
+			mx = _mm256_max_epu16(mx, v);
+		}
+		_mm256_storeu_si256((__m256i*)(lo + x), mn);
+		_mm256_storeu_si256((__m256i*)(hi + x), mx);
+	}
+	columnMinMaxTail(rows, rowCount, x, width, lo, hi);
+}
+
+TERRAIN_TARGET("sse2")
+void columnMinMaxF32SSE2(const float* const* rows, int rowCount, int width, float* lo, float* hi) {
+	int x = 0;
+	for (; x + 4 <= width; x += 4) {
+		__m128 mn = _mm_loadu_ps(rows[0] + x), mx = mn;
+		for (int r = 1; r < rowCount; r++) {
+			__m128 v = _mm_loadu_ps(rows[r] + x);
+			mn = _mm_min_ps(mn, v);
+			mx = _mm_max_ps(mx, v);
+		}
+		_mm_storeu_ps(lo + x, mn);
+		_mm_storeu_ps(hi + x, mx);
+	}
+	columnMinMaxTail(rows, rowCount, x, width, lo, hi);
+}
+
+TERRAIN_TARGET("avx2")
+void columnMinMaxF32AVX2(const float* const* rows, int rowCount, int width, float* lo, float* hi) {
+	int x = 0;
+	for (; x + 8 <= width; x += 8) {
+		__m256 mn = _mm256_loadu_ps(rows[0] + x), mx = mn;
+		for (int r = 1; r < rowCount; r++) {
+			__m256 v = _mm256_loadu_ps(rows[r] + x);
+			mn = _mm256_min_ps(mn, v);
+			mx = _mm256_max_ps(mx, v);
+		}
+		_mm256_storeu_ps(lo + x, mn);
+		_mm256_storeu_ps(hi + x, mx);
+	}
+	columnMinMaxTail(rows, rowCount, x, width, lo, hi);
+}
+
+#else
+
+// non-x86 builds only ever dispatch to the scalar path
+void columnMinMaxR16SSE2(const uint16_t* const*, int, int, uint16_t*, uint16_t*) {}
+void columnMinMaxR16SSE41(const uint16_t* const*, int, int, uint16_t*, uint16_t*) {}
+void columnMinMaxR16AVX2(const uint16_t* const*, int, int, uint16_t*, uint16_t*) {}
+void columnMinMaxF32SSE2(const float* const*, int, int, float*, float*) {}
+void columnMinMaxF32AVX2(const float* const*, int, int, float*, float*) {}
+
+#endif
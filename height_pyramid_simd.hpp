@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+	Vectorized column reductions for the leaf pass of HeightPyramid: lo[x]
+	and hi[x] become the smallest and largest of rows[0][x] ..
+	rows[rowCount - 1][x] for x in [0, width). Loads are unaligned, the
+	columns past the last full vector are done one at a time.
+*/
+
+void columnMinMaxR16SSE2(const uint16_t* const* rows, int rowCount, int width, uint16_t* lo, uint16_t* hi);
+void columnMinMaxR16SSE41(const uint16_t* const* rows, int rowCount, int width, uint16_t* lo, uint16_t* hi);
+void columnMinMaxR16AVX2(const uint16_t* const* rows, int rowCount, int width, uint16_t* lo, uint16_t* hi);
+
+void columnMinMaxF32SSE2(const float* const* rows, int rowCount, int width, float* lo, float* hi);
+void columnMinMaxF32AVX2(const float* const* rows, int rowCount, int width, float* lo, float* hi);
@@ -0,0 +1,60 @@
+#include "height_pyramid_texture.hpp"
+
+HeightPyramidTexture::HeightPyramidTexture() {}
+
+HeightPyramidTexture::~HeightPyramidTexture() {
+	destroy();
+}
+
+void HeightPyramidTexture::upload(const HeightPyramid& pyramid) {
+	if (pyramid.empty()) {
+		return;
+	}
+
+	bool whole = !m_texture || m_width != pyramid.levelWidth(0) || m_height != pyramid.levelHeight(0) ||
+		m_levels != pyramid.levelCount();
+	if (whole) {
+		destroy();
+		m_width = pyramid.levelWidth(0);
+		m_height = pyramid.levelHeight(0);
+		m_levels = pyramid.levelCount();
+
+		glGenTextures(1, &m_texture);
+		glBindTexture(GL_TEXTURE_2D, m_texture);
+		// the level sizes halve rounding down, exactly what immutable storage expects
+		glTexStorage2D(GL_TEXTURE_2D, m_levels, GL_RG16, m_width, m_height);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	}
+	else {
+		glBindTexture(GL_TEXTURE_2D, m_texture);
+	}
+
+	for (int level = 0; level < m_levels; level++) {
+		int width = pyramid.levelWidth(level);
+		glm::ivec4 rect = whole ? glm::ivec4(0, 0, width, pyramid.levelHeight(level)) : pyramid.dirty(level);
+		if (rect.x == rect.z) {
+			continue;
+		}
+
+		// a sub-rectangle straight out of the level, rows are a whole node count apart
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+		glTexSubImage2D(GL_TEXTURE_2D, level, rect.x, rect.y, rect.z - rect.x, rect.w - rect.y, GL_RG, GL_UNSIGNED_SHORT,
+			pyramid.levelData(level) + ((size_t)rect.y * width + rect.x) * 2);
+	}
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
+
+void HeightPyramidTexture::destroy() {
+	if (m_texture) {
+		glDeleteTextures(1, &m_texture);
+	}
+	m_texture = 0;
+	m_width = m_height = m_levels = 0;
+}
+
+GLuint HeightPyramidTexture::texture() const {
+	return m_texture;
+}
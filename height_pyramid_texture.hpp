@@ -0,0 +1,35 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "height_pyramid.hpp"
+
+/*
+	GL_RG16 GL_TEXTURE_2D holding a HeightPyramid, one mip level per
+	pyramid level, min in .r and max in .g. Filtering is
+	GL_NEAREST_MIPMAP_NEAREST: a texelFetch or textureLod at a whole level
+	reads exactly one node.
+*/
+class HeightPyramidTexture {
+private:
+	GLuint m_texture = 0;
+	int m_width = 0;
+	int m_height = 0;
+	int m_levels = 0;
+public:
+	HeightPyramidTexture();
+	~HeightPyramidTexture();
+
+	HeightPyramidTexture(const HeightPyramidTexture&) = delete;
+	HeightPyramidTexture& operator=(const HeightPyramidTexture&) = delete;
+
+	/*
+		Uploads the nodes of every level the pyramid marks dirty, the whole
+		chain when the texture does not exist yet or the pyramid changed size.
+		Call pyramid.clearDirty() once every consumer has seen the changes.
+	*/
+	void upload(const HeightPyramid& pyramid);
+	void destroy();
+
+	GLuint texture() const;
+};
@@ -0,0 +1,136 @@
+#include "height_sampler.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+/*
+	The scalar sampler the kernels in height_sampler_simd.cpp reproduce
+	operation for operation. Maps narrower than 2 texels only come through
+	here and sample their one row or column.
+*/
+static inline float bilinearAt(const HeightGrid& grid, float x, float z, glm::vec3* normal) {
+	float maxX = (float)(grid.width - 1), maxZ = (float)(grid.height - 1);
+	float lastX = (float)std::max(grid.width - 2, 0), lastZ = (float)std::max(grid.height - 2, 0);
+
+	// clamped onto the map in the order _mm_max_ps and _mm_min_ps compare, NaN lands on 0
+	float tx = x - grid.originX, tz = z - grid.originZ;
+	tx = tx > 0.0f ? tx : 0.0f;
+	tx = tx < maxX ? tx : maxX;
+	tz = tz > 0.0f ? tz : 0.0f;
+	tz = tz < maxZ ? tz : maxZ;
+
+	// the far border belongs to the last cell, at u or v = 1
+	int cx = (int)(tx < lastX ? tx : lastX), cz = (int)(tz < lastZ ? tz : lastZ);
+	float u = tx - (float)cx, v = tz - (float)cz;
+	int x1 = std::min(cx + 1, grid.width - 1), z1 = std::min(cz + 1, grid.height - 1);
+
+	size_t row0 = (size_t)cz * grid.width, row1 = (size_t)z1 * grid.width;
+	float h00, h10, h01, h11;
+	if (grid.r16) {
+		const uint16_t* texels = (const uint16_t*)grid.texels;
+		h00 = texels[row0 + cx] / 65535.0f;
+		h10 = texels[row0 + x1] / 65535.0f;
+		h01 = texels[row1 + cx] / 65535.0f;
+		h11 = texels[row1 + x1] / 65535.0f;
+	}
+	else {
+		const float* texels = (const float*)grid.texels;
+		h00 = texels[row0 + cx];
+		h10 = texels[row0 + x1];
+		h01 = texels[row1 + cx];
+		h11 = texels[row1 + x1];
+	}
+
+	float h0 = h00 + (h10 - h00) * u;
+	float h1 = h01 + (h11 - h01) * u;
+	float h = h0 + (h1 - h0) * v;
+
+	if (normal) {
+		// texels are one world unit apart, the height derivatives are the slopes
+		float du = (h10 - h00) + ((h11 - h01) - (h10 - h00)) * v;
+		float dv = h1 - h0;
+		float sx = du * -HEIGHT_SCALE, sz = dv * -HEIGHT_SCALE;
+		float inv = 1.0f / std::sqrt(sx * sx + 1.0f + sz * sz);
+		*normal = glm::vec3(sx * inv, inv, sz * inv);
+	}
+	return worldHeight(h);
+}
+
+static int bilinearSample(const HeightGrid& grid, const float* x, const float* z, int count, float* heights,
+	float* nx, float* ny, float* nz)
+{
+	if (grid.width < 2 || grid.height < 2) {
+		return 0;
+	}
+	switch (simdLevel()) {
+	case SIMD_AVX2:
+		if ((size_t)grid.width * grid.height < ((size_t)1 << 31)) {
+			return bilinearSampleAVX2(grid, x, z, count, heights, nx, ny, nz);
+		}
+		return bilinearSampleSSE2(grid, x, z, count, heights, nx, ny, nz);
+	// SSE4.1 adds nothing the lanes need
+	case SIMD_SSE41:
+	case SIMD_SSE2:
+		return bilinearSampleSSE2(grid, x, z, count, heights, nx, ny, nz);
+	default:
+		return 0;
+	}
+}
+
+HeightSampler::HeightSampler(const Heightmap& map, glm::vec2 origin)
+	: m_map(map)
+{
+	m_grid.texels = map.data();
+	m_grid.width = map.width();
+	m_grid.height = map.height();
+	m_grid.r16 = map.format() == HEIGHT_R16;
+	m_grid.originX = origin.x;
+	m_grid.originZ = origin.y;
+}
+
+float HeightSampler::heightAt(float x, float z) const {
+	if (m_map.empty()) {
+		return 0.0f;
+	}
+	return bilinearAt(m_grid, x, z, nullptr);
+}
+
+glm::vec3 HeightSampler::normalAt(float x, float z) const {
+	glm::vec3 normal(0.0f, 1.0f, 0.0f);
+	if (!m_map.empty()) {
+		bilinearAt(m_grid, x, z, &normal);
+	}
+	return normal;
+}
+
+void HeightSampler::heightsAt(const float* x, const float* z, float* heights, int count) const {
+	sample(x, z, heights, nullptr, nullptr, nullptr, count);
+}
+
+void HeightSampler::sample(const float* x, const float* z, float* heights, float* nx, float* ny, float* nz,
+	int count) const
+{
+	if (m_map.empty()) {
+		for (int i = 0; i < count; i++) {
+			heights[i] = 0.0f;
+			if (nx) {
+				nx[i] = 0.0f;
+				ny[i] = 1.0f;
+				nz[i] = 0.0f;
+			}
+		}
+		return;
+	}
+
+	int i = bilinearSample(m_grid, x, z, count, heights, nx, ny, nz);
+	for (; i < count; i++) {
+		glm::vec3 normal;
+		heights[i] = bilinearAt(m_grid, x[i], z[i], nx ? &normal : nullptr);
+		if (nx) {
+			nx[i] = normal.x;
+			ny[i] = normal.y;
+			nz[i] = normal.z;
+		}
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "heightmap.hpp"
+#include "height_sampler_simd.hpp"
+
+/*
+	Height and normal of the terrain at any world xz, for placing things on
+	the ground and keeping the camera above it. The surface is the one
+	tess_eval.glsl displaces to and TerrainRaycaster hits: texels one world
+	unit apart, bilinear in between, at worldHeight() (height * 64 - 16).
+	Points off the map take the height of the nearest border point, as
+	GL_CLAMP_TO_EDGE does.
+
+	The batched calls take SoA arrays and run on the widest SIMD level
+	available, with results bit-identical to heightAt() and normalAt().
+
+	The heightmap is referenced, not copied, and must outlive the sampler.
+	Queries are const and safe from any number of threads.
+*/
+class HeightSampler {
+private:
+	const Heightmap& m_map;
+	HeightGrid m_grid;
+public:
+	// origin is the world xz of texel (0, 0)
+	HeightSampler(const Heightmap& map, glm::vec2 origin = glm::vec2(0.0f));
+
+	float heightAt(float x, float z) const;
+	glm::vec3 normalAt(float x, float z) const;
+
+	// heights[i] at (x[i], z[i])
+	void heightsAt(const float* x, const float* z, float* heights, int count) const;
+
+	// heights and unit normals (nx[i], ny[i], nz[i]) at (x[i], z[i])
+	void sample(const float* x, const float* z, float* heights, float* nx, float* ny, float* nz, int count) const;
+};
@@ -0,0 +1,163 @@
+#include "height_sampler_simd.hpp"
+#include "heightmap.hpp"
+#include "simd.hpp"
+
+#include <cstddef>
+
+#ifdef TERRAIN_X86
+#include <immintrin.h>
+
+// no gathers, the corners are loaded one lane at a time
+TERRAIN_TARGET("sse2")
+int bilinearSampleSSE2(const HeightGrid& grid, const float* x, const float* z, int count, float* heights,
+	float* nx, float* ny, float* nz)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 maxX = _mm_set1_ps((float)(grid.width - 1)), maxZ = _mm_set1_ps((float)(grid.height - 1));
+	const __m128 lastX = _mm_set1_ps((float)(grid.width - 2)), lastZ = _mm_set1_ps((float)(grid.height - 2));
+	const __m128 originX = _mm_set1_ps(grid.originX), originZ = _mm_set1_ps(grid.originZ);
+	const __m128 steps = _mm_set1_ps(65535.0f);
+	const __m128 scale = _mm_set1_ps(HEIGHT_SCALE), offset = _mm_set1_ps(HEIGHT_OFFSET);
+	const __m128 slope = _mm_set1_ps(-HEIGHT_SCALE);
+	const uint16_t* texels16 = (const uint16_t*)grid.texels;
+	const float* texels32 = (const float*)grid.texels;
+	size_t width = (size_t)grid.width;
+
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 tx = _mm_min_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(x + i), originX), zero), maxX);
+		__m128 tz = _mm_min_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(z + i), originZ), zero), maxZ);
+		__m128i cx = _mm_cvttps_epi32(_mm_min_ps(tx, lastX));
+		__m128i cz = _mm_cvttps_epi32(_mm_min_ps(tz, lastZ));
+		__m128 u = _mm_sub_ps(tx, _mm_cvtepi32_ps(cx));
+		__m128 v = _mm_sub_ps(tz, _mm_cvtepi32_ps(cz));
+
+		alignas(16) int32_t cells[8];
+		_mm_store_si128((__m128i*)cells, cx);
+		_mm_store_si128((__m128i*)(cells + 4), cz);
+		alignas(16) float corners[16];
+		for (int lane = 0; lane < 4; lane++) {
+			size_t t = (size_t)cells[4 + lane] * width + (size_t)cells[lane];
+			if (grid.r16) {
+				corners[lane] = (float)texels16[t];
+				corners[4 + lane] = (float)texels16[t + 1];
+				corners[8 + lane] = (float)texels16[t + width];
+				corners[12 + lane] = (float)texels16[t + width + 1];
+			}
+			else {
+				corners[lane] = texels32[t];
+				corners[4 + lane] = texels32[t + 1];
+				corners[8 + lane] = texels32[t + width];
+				corners[12 + lane] = texels32[t + width + 1];
+			}
+		}
+		__m128 h00 = _mm_load_ps(corners), h10 = _mm_load_ps(corners + 4);
+		__m128 h01 = _mm_load_ps(corners + 8), h11 = _mm_load_ps(corners + 12);
+		if (grid.r16) {
+			h00 = _mm_div_ps(h00, steps);
+			h10 = _mm_div_ps(h10, steps);
+			h01 = _mm_div_ps(h01, steps);
+			h11 = _mm_div_ps(h11, steps);
+		}
+
+		__m128 dx0 = _mm_sub_ps(h10, h00);
+		__m128 h0 = _mm_add_ps(h00, _mm_mul_ps(dx0, u));
+		__m128 h1 = _mm_add_ps(h01, _mm_mul_ps(_mm_sub_ps(h11, h01), u));
+		__m128 dv = _mm_sub_ps(h1, h0);
+		__m128 h = _mm_add_ps(h0, _mm_mul_ps(dv, v));
+		_mm_storeu_ps(heights + i, _mm_add_ps(_mm_mul_ps(h, scale), offset));
+
+		if (nx) {
+			__m128 du = _mm_add_ps(dx0, _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(h11, h01), dx0), v));
+			__m128 sx = _mm_mul_ps(du, slope), sz = _mm_mul_ps(dv, slope);
+			__m128 inv = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, sx), one), _mm_mul_ps(sz, sz))));
+			_mm_storeu_ps(nx + i, _mm_mul_ps(sx, inv));
+			_mm_storeu_ps(ny + i, inv);
+			_mm_storeu_ps(nz + i, _mm_mul_ps(sz, inv));
+		}
+	}
+	return i;
+}
+
+/*
+	One 32 bit gather per row fetches both R16 texels of a cell side, the
+	low half is the left one. It never reads past the map: the cell's right
+	texel is at most the last one.
+*/
+TERRAIN_TARGET("avx2")
+int bilinearSampleAVX2(const HeightGrid& grid, const float* x, const float* z, int count, float* heights,
+	float* nx, float* ny, float* nz)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 maxX = _mm256_set1_ps((float)(grid.width - 1)), maxZ = _mm256_set1_ps((float)(grid.height - 1));
+	const __m256 lastX = _mm256_set1_ps((float)(grid.width - 2)), lastZ = _mm256_set1_ps((float)(grid.height - 2));
+	const __m256 originX = _mm256_set1_ps(grid.originX), originZ = _mm256_set1_ps(grid.originZ);
+	const __m256 steps = _mm256_set1_ps(65535.0f);
+	const __m256 scale = _mm256_set1_ps(HEIGHT_SCALE), offset = _mm256_set1_ps(HEIGHT_OFFSET);
+	const __m256 slope = _mm256_set1_ps(-HEIGHT_SCALE);
+	const __m256i stride = _mm256_set1_epi32(grid.width);
+	const __m256i right = _mm256_set1_epi32(1);
+	const __m256i low = _mm256_set1_epi32(0xFFFF);
+
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 tx = _mm256_min_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_loadu_ps(x + i), originX), zero), maxX);
+		__m256 tz = _mm256_min_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_loadu_ps(z + i), originZ), zero), maxZ);
+		__m256i cx = _mm256_cvttps_epi32(_mm256_min_ps(tx, lastX));
+		__m256i cz = _mm256_cvttps_epi32(_mm256_min_ps(tz, lastZ));
+		__m256 u = _mm256_sub_ps(tx, _mm256_cvtepi32_ps(cx));
+		__m256 v = _mm256_sub_ps(tz, _mm256_cvtepi32_ps(cz));
+
+		__m256i t0 = _mm256_add_epi32(_mm256_mullo_epi32(cz, stride), cx);
+		__m256i t1 = _mm256_add_epi32(t0, stride);
+		__m256 h00, h10, h01, h11;
+		if (grid.r16) {
+			const int* texels = (const int*)grid.texels;
+			__m256i row0 = _mm256_i32gather_epi32(texels, t0, 2);
+			__m256i row1 = _mm256_i32gather_epi32(texels, t1, 2);
+			h00 = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_and_si256(row0, low)), steps);
+			h10 = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(row0, 16)), steps);
+			h01 = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_and_si256(row1, low)), steps);
+			h11 = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(row1, 16)), steps);
+		}
+		else {
+			const float* texels = (const float*)grid.texels;
+			h00 = _mm256_i32gather_ps(texels, t0, 4);
+			h10 = _mm256_i32gather_ps(texels, _mm256_add_epi32(t0, right), 4);
+			h01 = _mm256_i32gather_ps(texels, t1, 4);
+			h11 = _mm256_i32gather_ps(texels, _mm256_add_epi32(t1, right), 4);
+		}
+
+		__m256 dx0 = _mm256_sub_ps(h10, h00);
+		__m256 h0 = _mm256_add_ps(h00, _mm256_mul_ps(dx0, u));
+		__m256 h1 = _mm256_add_ps(h01, _mm256_mul_ps(_mm256_sub_ps(h11, h01), u));
+		__m256 dv = _mm256_sub_ps(h1, h0);
+		__m256 h = _mm256_add_ps(h0, _mm256_mul_ps(dv, v));
+		_mm256_storeu_ps(heights + i, _mm256_add_ps(_mm256_mul_ps(h, scale), offset));
+
+		if (nx) {
+			__m256 du = _mm256_add_ps(dx0, _mm256_mul_ps(_mm256_sub_ps(_mm256_sub_ps(h11, h01), dx0), v));
+			__m256 sx = _mm256_mul_ps(du, slope), sz = _mm256_mul_ps(dv, slope);
+			__m256 inv = _mm256_div_ps(one,
+				_mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sx, sx), one), _mm256_mul_ps(sz, sz))));
+			_mm256_storeu_ps(nx + i, _mm256_mul_ps(sx, inv));
+			_mm256_storeu_ps(ny + i, inv);
+			_mm256_storeu_ps(nz + i, _mm256_mul_ps(sz, inv));
+		}
+	}
+	return i;
+}
+
+#else
+
+// non-x86 builds only ever dispatch to the scalar path
+int bilinearSampleSSE2(const HeightGrid&, const float*, const float*, int, float*, float*, float*, float*) {
+	return 0;
+}
+int bilinearSampleAVX2(const HeightGrid&, const float*, const float*, int, float*, float*, float*, float*) {
+	return 0;
+}
+
+#endif
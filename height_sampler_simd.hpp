@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+// raw texels of a Heightmap as the bilinear kernels read them
+struct HeightGrid {
+	const void* texels;  // row-major, uint16_t (r16) or float
+	int width;           // at least 2
+	int height;          // at least 2
+	bool r16;
+	float originX;       // world xz of texel (0, 0)
+	float originZ;
+};
+
+/*
+	Vectorized HeightSampler kernels, SoA in and out: world heights and,
+	when nx is not null, unit normals of points (x[i], z[i]). Every kernel
+	performs the same float operations in the same order as the scalar
+	sampler (no FMA contraction), so the results are bit-identical to it.
+
+	Only whole vectors are done, the return value is how many points that
+	was; the caller samples the rest. The AVX2 kernel gathers with 32 bit
+	indices and needs width * height below 2^31.
+*/
+
+int bilinearSampleSSE2(const HeightGrid& grid, const float* x, const float* z, int count, float* heights,
+	float* nx, float* ny, float* nz);
+int bilinearSampleAVX2(const HeightGrid& grid, const float* x, const float* z, int count, float* heights,
+	float* nx, float* ny, float* nz);
@@ -0,0 +1,102 @@
+#include "height_tiles.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+HeightTiles::Tile::Tile(Heightmap&& texels, glm::vec2 origin)
+	: map(std::move(texels)), sampler(map, origin)
+{}
+
+HeightTiles::HeightTiles(int tileSize, glm::vec2 origin)
+	: m_tileSize(std::max(1, tileSize)), m_origin(origin)
+{}
+
+int64_t HeightTiles::key(glm::ivec2 coord) {
+	return ((int64_t)coord.x << 32) | (uint32_t)coord.y;
+}
+
+void HeightTiles::build(int width, int height, HEIGHT_FORMAT format, const std::function<float(int, int)>& sample) {
+	clear();
+	int tilesX = std::max(1, (width - 1 + m_tileSize - 1) / m_tileSize);
+	int tilesY = std::max(1, (height - 1 + m_tileSize - 1) / m_tileSize);
+
+	for (int ty = 0; ty < tilesY; ty++) {
+		for (int tx = 0; tx < tilesX; tx++) {
+			int x0 = tx * m_tileSize, y0 = ty * m_tileSize;
+			int w = std::min(m_tileSize + 1, width - x0), h = std::min(m_tileSize + 1, height - y0);
+
+			Heightmap texels(w, h, format);
+			for (int y = 0; y < h; y++) {
+				for (int x = 0; x < w; x++) {
+					float value = sample(x0 + x, y0 + y);
+					size_t i = (size_t)y * w + x;
+					if (format == HEIGHT_R16) {
+						// samples of an R16 source come back to the very same step
+						quantizeR16(&value, (uint16_t*)texels.data() + i, 1);
+					}
+					else {
+						((float*)texels.data())[i] = value;
+					}
+				}
+			}
+			insert(glm::ivec2(tx, ty), std::move(texels));
+		}
+	}
+}
+
+void HeightTiles::insert(glm::ivec2 coord, Heightmap&& texels) {
+	glm::vec2 origin = m_origin + glm::vec2(coord) * (float)m_tileSize;
+	m_tiles[key(coord)] = std::make_unique<Tile>(std::move(texels), origin);
+}
+
+void HeightTiles::erase(glm::ivec2 coord) {
+	m_tiles.erase(key(coord));
+}
+
+void HeightTiles::clear() {
+	m_tiles.clear();
+}
+
+int HeightTiles::tileSize() const {
+	return m_tileSize;
+}
+
+int HeightTiles::tileCount() const {
+	return (int)m_tiles.size();
+}
+
+size_t HeightTiles::sizeBytes() const {
+	size_t bytes = 0;
+	for (const auto& [k, tile] : m_tiles) {
+		bytes += tile->map.sizeBytes();
+	}
+	return bytes;
+}
+
+const HeightTiles::Tile* HeightTiles::find(float x, float z) const {
+	glm::vec2 p = (glm::vec2(x, z) - m_origin) / (float)m_tileSize;
+	// far outside any tile an int coordinate could name, NaN included
+	if (!(std::fabs(p.x) < 1e9f && std::fabs(p.y) < 1e9f)) {
+		return nullptr;
+	}
+	auto it = m_tiles.find(key(glm::ivec2(glm::floor(p))));
+	return it == m_tiles.end() ? nullptr : it->second.get();
+}
+
+bool HeightTiles::heightAt(float x, float z, float& height) const {
+	const Tile* tile = find(x, z);
+	if (!tile) {
+		return false;
+	}
+	height = tile->sampler.heightAt(x, z);
+	return true;
+}
+
+bool HeightTiles::normalAt(float x, float z, glm::vec3& normal) const {
+	const Tile* tile = find(x, z);
+	if (!tile) {
+		return false;
+	}
+	normal = tile->sampler.normalAt(x, z);
+	return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+
+#include "heightmap.hpp"
+#include "height_sampler.hpp"
+
+/*
+	Terrain heights kept resident on the CPU for ground queries, in square
+	tiles of tileSize cells. A tile holds tileSize + 1 texels per side, so
+	neighbouring tiles share their border texels and a lookup reads one
+	small tile, never a whole map row apart. Tile (tx, ty) covers world xz
+	origin + [tx, tx + 1) * tileSize.
+
+	Tiles come from the streamed chunks as they are uploaded, or from
+	build() over a whole heightmap. Queries sample with HeightSampler and
+	only fail where no tile is resident.
+*/
+class HeightTiles {
+private:
+	struct Tile {
+		Heightmap map;
+		HeightSampler sampler;
+
+		Tile(Heightmap&& texels, glm::vec2 origin);
+	};
+
+	int m_tileSize;
+	glm::vec2 m_origin;
+	std::unordered_map<int64_t, std::unique_ptr<Tile>> m_tiles;
+
+	static int64_t key(glm::ivec2 coord);
+	const Tile* find(float x, float z) const;
+public:
+	// origin is the world xz of texel (0, 0) of tile (0, 0)
+	explicit HeightTiles(int tileSize = 128, glm::vec2 origin = glm::vec2(0.0f));
+
+	// cuts a width x height heightmap into tiles, sample returns normalized heights
+	void build(int width, int height, HEIGHT_FORMAT format, const std::function<float(int, int)>& sample);
+
+	// texels is tileSize + 1 texels per side, smaller at the far edges of a map
+	void insert(glm::ivec2 coord, Heightmap&& texels);
+	void erase(glm::ivec2 coord);
+	void clear();
+
+	int tileSize() const;
+	int tileCount() const;
+	size_t sizeBytes() const;
+
+	// world height at (x, z), false where no tile is resident
+	bool heightAt(float x, float z, float& height) const;
+	bool normalAt(float x, float z, glm::vec3& normal) const;
+};
@@ -0,0 +1,149 @@
+#include "heightmap.hpp"
+#include "stb_image.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+size_t heightFormatSize(HEIGHT_FORMAT format) {
+	return format == HEIGHT_R16 ? sizeof(uint16_t) : sizeof(float);
+}
+
+static bool hasExtension(const std::string& path, const char* extension) {
+	size_t length = strlen(extension);
+	if (path.size() < length) {
+		return false;
+	}
+	for (size_t i = 0; i < length; i++) {
+		if (tolower((unsigned char)path[path.size() - length + i]) != extension[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+Heightmap::Heightmap() {}
+
+Heightmap::Heightmap(int width, int height, HEIGHT_FORMAT format)
+	: m_width(width), m_height(height), m_format(format),
+	m_storage((size_t)width * height * heightFormatSize(format))
+{}
+
+void quantizeR16(const float* heights, uint16_t* out, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		float h = std::clamp(heights[i], 0.0f, 1.0f);
+		out[i] = (uint16_t)(h * 65535.0f + 0.5f);
+	}
+}
+
+Heightmap Heightmap::fromFloats(const float* heights, int width, int height, HEIGHT_FORMAT format) {
+	Heightmap map(width, height, format);
+	size_t count = (size_t)width * height;
+
+	if (format == HEIGHT_R32F) {
+		memcpy(map.m_storage.data(), heights, count * sizeof(float));
+		return map;
+	}
+
+	quantizeR16(heights, (uint16_t*)map.m_storage.data(), count);
+	return map;
+}
+
+bool Heightmap::load(const std::string& path) {
+	if (hasExtension(path, ".r16") || hasExtension(path, ".r32")) {
+		HEIGHT_FORMAT format = hasExtension(path, ".r16") ? HEIGHT_R16 : HEIGHT_R32F;
+
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file) {
+			std::cout << "COULD NOT LOAD THE HEIGHTMAP: cannot open " << path << std::endl;
+			return false;
+		}
+
+		size_t bytes = (size_t)file.tellg();
+		size_t samples = bytes / heightFormatSize(format);
+		int side = (int)std::lround(std::sqrt((double)samples));
+		if (side == 0 || (size_t)side * side * heightFormatSize(format) != bytes) {
+			std::cout << "COULD NOT LOAD THE HEIGHTMAP: raw heightmaps must be square, got "
+				<< bytes << " bytes" << std::endl;
+			return false;
+		}
+
+		*this = Heightmap(side, side, format);
+		file.seekg(0);
+		file.read((char*)m_storage.data(), (std::streamsize)bytes);
+		return true;
+	}
+
+	int width, height, channels;
+
+	if (stbi_is_hdr(path.c_str())) {
+		float* pixels = stbi_loadf(path.c_str(), &width, &height, &channels, 0);
+		if (!pixels) {
+			std::cout << "COULD NOT LOAD THE HEIGHTMAP: " << stbi_failure_reason() << std::endl;
+			return false;
+		}
+
+		*this = Heightmap(width, height, HEIGHT_R32F);
+		int channel = channels >= 3 ? 1 : 0;
+		float* out = (float*)m_storage.data();
+		for (size_t i = 0; i < (size_t)width * height; i++) {
+			out[i] = pixels[i * channels + channel];
+		}
+		stbi_image_free(pixels);
+		return true;
+	}
+
+	// 8 bit images are widened to 16 bit by stb_image (v * 257), so 255 still maps to 65535
+	stbi_us* pixels = stbi_load_16(path.c_str(), &width, &height, &channels, 0);
+	if (!pixels) {
+		std::cout << "COULD NOT LOAD THE HEIGHTMAP: " << stbi_failure_reason() << std::endl;
+		return false;
+	}
+
+	*this = Heightmap(width, height, HEIGHT_R16);
+	int channel = channels >= 3 ? 1 : 0;
+	uint16_t* out = (uint16_t*)m_storage.data();
+	for (size_t i = 0; i < (size_t)width * height; i++) {
+		out[i] = pixels[i * channels + channel];
+	}
+	stbi_image_free(pixels);
+	return true;
+}
+
+int Heightmap::width() const {
+	return m_width;
+}
+
+int Heightmap::height() const {
+	return m_height;
+}
+
+HEIGHT_FORMAT Heightmap::format() const {
+	return m_format;
+}
+
+size_t Heightmap::sizeBytes() const {
+	return m_storage.size();
+}
+
+bool Heightmap::empty() const {
+	return m_storage.empty();
+}
+
+const void* Heightmap::data() const {
+	return m_storage.data();
+}
+
+void* Heightmap::data() {
+	return m_storage.data();
+}
+
+float Heightmap::sample(int x, int y) const {
+	size_t i = (size_t)y * m_width + x;
+	if (m_format == HEIGHT_R16) {
+		return ((const uint16_t*)m_storage.data())[i] / 65535.0f;
+	}
+	return ((const float*)m_storage.data())[i];
+}
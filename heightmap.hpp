@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum HEIGHT_FORMAT {
+	HEIGHT_R16,  // unsigned normalized 16 bit, GL_R16
+	HEIGHT_R32F  // GL_R32F
+};
+
+size_t heightFormatSize(HEIGHT_FORMAT format);
+
+/*
+	World height of a normalized heightmap sample, the same mapping
+	tess_eval.glsl applies (height * 64 - 16).
+*/
+static const float HEIGHT_SCALE = 64.0f;
+static const float HEIGHT_OFFSET = -16.0f;
+
+inline float worldHeight(float normalized) {
+	return normalized * HEIGHT_SCALE + HEIGHT_OFFSET;
+}
+
+// heights in [0, 1] to R16 texels, clamped and rounded to the nearest step
+void quantizeR16(const float* heights, uint16_t* out, size_t count);
+
+/*
+	Single-channel heightfield in host memory, laid out row-major exactly as
+	it is uploaded with glTexImage2D(..., GL_RED, ...). Heights are
+	normalized: 0..65535 for R16, 0.0..1.0 for R32F.
+*/
+class Heightmap {
+private:
+	int m_width = 0;
+	int m_height = 0;
+	HEIGHT_FORMAT m_format = HEIGHT_R16;
+	std::vector<unsigned char> m_storage;
+public:
+	Heightmap();
+	Heightmap(int width, int height, HEIGHT_FORMAT format);
+
+	// quantizes (R16) or copies (R32F) a buffer of heights in [0, 1]
+	static Heightmap fromFloats(const float* heights, int width, int height, HEIGHT_FORMAT format);
+
+	/*
+		Loads a heightmap from disk:
+		  - images stb_image understands (8/16 bit PNG, ...) become R16. Multi
+		    channel images keep the green channel, which is what the shaders
+		    used to sample from the RGBA texture
+		  - .hdr images become R32F
+		  - headerless square .r16 / .r32 dumps (little endian) as exported
+		    by most terrain tools
+		Prints the reason and returns false on failure.
+	*/
+	bool load(const std::string& path);
+
+	int width() const;
+	int height() const;
+	HEIGHT_FORMAT format() const;
+	size_t sizeBytes() const;
+	bool empty() const;
+
+	const void* data() const;
+	void* data();
+
+	// normalized height in [0, 1] of texel (x, y)
+	float sample(int x, int y) const;
+};
@@ -0,0 +1,307 @@
+#include "heightmap_file.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const uint64_t TILE_ALIGNMENT = 64;
+static const char PADDING[TILE_ALIGNMENT] = {};
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+MappedFile::MappedFile() {}
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+bool MappedFile::open(const std::string& path) {
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping) {
+		CloseHandle(file);
+		return false;
+	}
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!view) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	m_file = file;
+	m_mapping = mapping;
+	m_data = (const unsigned char*)view;
+	m_size = (size_t)size.QuadPart;
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+
+	void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// the mapping keeps its own reference to the file
+	::close(fd);
+	if (view == MAP_FAILED) {
+		return false;
+	}
+
+	// the whole file is read front to back by the texture upload
+	madvise(view, (size_t)info.st_size, MADV_SEQUENTIAL);
+	madvise(view, (size_t)info.st_size, MADV_WILLNEED);
+
+	m_data = (const unsigned char*)view;
+	m_size = (size_t)info.st_size;
+#endif
+	return true;
+}
+
+void MappedFile::close() {
+	if (!m_data) {
+		return;
+	}
+
+#ifdef _WIN32
+	UnmapViewOfFile(m_data);
+	CloseHandle((HANDLE)m_mapping);
+	CloseHandle((HANDLE)m_file);
+	m_mapping = nullptr;
+	m_file = nullptr;
+#else
+	munmap((void*)m_data, m_size);
+#endif
+	m_data = nullptr;
+	m_size = 0;
+}
+
+const unsigned char* MappedFile::data() const {
+	return m_data;
+}
+
+size_t MappedFile::size() const {
+	return m_size;
+}
+
+bool HeightmapFile::open(const std::string& path) {
+	m_header = nullptr;
+	m_offsets = nullptr;
+
+	if (!m_file.open(path)) {
+		std::cout << "COULD NOT MAP THE HEIGHTMAP FILE: " << path << std::endl;
+		return false;
+	}
+
+	// every check below leaves the file unmapped when it fails
+	const HmapHeader* header = (const HmapHeader*)m_file.data();
+	if (m_file.size() < sizeof(HmapHeader) || memcmp(header->magic, HMAP_MAGIC, 4) != 0) {
+		std::cout << "NOT A HEIGHTMAP FILE: " << path << std::endl;
+		m_file.close();
+		return false;
+	}
+	if (header->version != HMAP_VERSION || header->fileSize != m_file.size()) {
+		std::cout << "UNSUPPORTED OR TRUNCATED HEIGHTMAP FILE: " << path << std::endl;
+		m_file.close();
+		return false;
+	}
+	// sizes are handed out as int, and the tile counts are checked in 64 bits so a huge width cannot wrap them
+	if (header->format > HEIGHT_R32F || header->tileSize == 0 ||
+		header->width > INT_MAX || header->height > INT_MAX || header->tileSize > INT_MAX ||
+		header->tilesX != ((uint64_t)header->width + header->tileSize - 1) / header->tileSize ||
+		header->tilesY != ((uint64_t)header->height + header->tileSize - 1) / header->tileSize)
+	{
+		std::cout << "CORRUPT HEIGHTMAP FILE HEADER: " << path << std::endl;
+		m_file.close();
+		return false;
+	}
+
+	// offsets come from the file, compared as offset > size || bytes > size - offset so nothing can wrap past the end
+	uint64_t fileSize = m_file.size();
+	uint64_t tileCount = (uint64_t)header->tilesX * header->tilesY;
+	if (header->tableOffset % sizeof(uint64_t) != 0 || header->tableOffset > fileSize ||
+		tileCount > (fileSize - header->tableOffset) / sizeof(uint64_t))
+	{
+		std::cout << "CORRUPT HEIGHTMAP FILE OFFSET TABLE: " << path << std::endl;
+		m_file.close();
+		return false;
+	}
+
+	m_header = header;
+	m_offsets = (const uint64_t*)(m_file.data() + header->tableOffset);
+
+	size_t sampleSize = heightFormatSize(format());
+	for (int ty = 0; ty < tilesY(); ty++) {
+		for (int tx = 0; tx < tilesX(); tx++) {
+			uint64_t offset = m_offsets[(size_t)ty * tilesX() + tx];
+			uint64_t bytes = (uint64_t)tileWidth(tx) * tileHeight(ty) * sampleSize;
+			if (offset % sampleSize != 0 || offset > fileSize || bytes > fileSize - offset) {
+				std::cout << "CORRUPT HEIGHTMAP FILE TILE " << tx << ", " << ty << ": " << path << std::endl;
+				m_header = nullptr;
+				m_offsets = nullptr;
+				m_file.close();
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+int HeightmapFile::width() const {
+	return (int)m_header->width;
+}
+
+int HeightmapFile::height() const {
+	return (int)m_header->height;
+}
+
+HEIGHT_FORMAT HeightmapFile::format() const {
+	return (HEIGHT_FORMAT)m_header->format;
+}
+
+int HeightmapFile::tileSize() const {
+	return (int)m_header->tileSize;
+}
+
+int HeightmapFile::tilesX() const {
+	return (int)m_header->tilesX;
+}
+
+int HeightmapFile::tilesY() const {
+	return (int)m_header->tilesY;
+}
+
+int HeightmapFile::tileWidth(int tx) const {
+	return std::min(tileSize(), width() - tx * tileSize());
+}
+
+int HeightmapFile::tileHeight(int ty) const {
+	return std::min(tileSize(), height() - ty * tileSize());
+}
+
+const void* HeightmapFile::tile(int tx, int ty) const {
+	return m_file.data() + m_offsets[ty * tilesX() + tx];
+}
+
+float HeightmapFile::sample(int x, int y) const {
+	int tx = x / tileSize(), ty = y / tileSize();
+	size_t i = (size_t)(y - ty * tileSize()) * tileWidth(tx) + (x - tx * tileSize());
+	if (format() == HEIGHT_R16) {
+		return ((const uint16_t*)tile(tx, ty))[i] / 65535.0f;
+	}
+	return ((const float*)tile(tx, ty))[i];
+}
+
+Heightmap HeightmapFile::toHeightmap() const {
+	Heightmap map(width(), height(), format());
+	size_t sampleSize = heightFormatSize(format());
+	unsigned char* out = (unsigned char*)map.data();
+
+	for (int ty = 0; ty < tilesY(); ty++) {
+		for (int tx = 0; tx < tilesX(); tx++) {
+			const unsigned char* src = (const unsigned char*)tile(tx, ty);
+			size_t rowBytes = (size_t)tileWidth(tx) * sampleSize;
+			for (int y = 0; y < tileHeight(ty); y++) {
+				size_t dst = ((size_t)(ty * tileSize() + y) * width() + (size_t)tx * tileSize()) * sampleSize;
+				memcpy(out + dst, src + y * rowBytes, rowBytes);
+			}
+		}
+	}
+	return map;
+}
+
+bool HeightmapFile::write(const std::string& path, const Heightmap& heightmap, int tileSize) {
+	HmapHeader header = {};
+	memcpy(header.magic, HMAP_MAGIC, 4);
+	header.version = HMAP_VERSION;
+	header.width = (uint32_t)heightmap.width();
+	header.height = (uint32_t)heightmap.height();
+	header.format = (uint32_t)heightmap.format();
+	header.tileSize = (uint32_t)tileSize;
+	header.tilesX = (header.width + header.tileSize - 1) / header.tileSize;
+	header.tilesY = (header.height + header.tileSize - 1) / header.tileSize;
+	header.tableOffset = sizeof(HmapHeader);
+
+	size_t sampleSize = heightFormatSize(heightmap.format());
+	std::vector<uint64_t> offsets((size_t)header.tilesX * header.tilesY);
+
+	uint64_t offset = alignUp(header.tableOffset + offsets.size() * sizeof(uint64_t), TILE_ALIGNMENT);
+	for (uint32_t ty = 0; ty < header.tilesY; ty++) {
+		for (uint32_t tx = 0; tx < header.tilesX; tx++) {
+			uint64_t tw = std::min(header.tileSize, header.width - tx * header.tileSize);
+			uint64_t th = std::min(header.tileSize, header.height - ty * header.tileSize);
+			offsets[ty * header.tilesX + tx] = offset;
+			offset = alignUp(offset + tw * th * sampleSize, TILE_ALIGNMENT);
+		}
+	}
+	header.fileSize = offset;
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file) {
+		std::cout << "COULD NOT WRITE THE HEIGHTMAP FILE: " << path << std::endl;
+		return false;
+	}
+
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)offsets.data(), (std::streamsize)(offsets.size() * sizeof(uint64_t)));
+
+	const unsigned char* src = (const unsigned char*)heightmap.data();
+	for (uint32_t ty = 0; ty < header.tilesY; ty++) {
+		for (uint32_t tx = 0; tx < header.tilesX; tx++) {
+			uint32_t tw = std::min(header.tileSize, header.width - tx * header.tileSize);
+			uint32_t th = std::min(header.tileSize, header.height - ty * header.tileSize);
+
+			// pad up to the tile's aligned start
+			file.write(PADDING, (std::streamsize)(offsets[ty * header.tilesX + tx] - (uint64_t)file.tellp()));
+
+			for (uint32_t y = 0; y < th; y++) {
+				size_t row = ((size_t)(ty * header.tileSize + y) * header.width + (size_t)tx * header.tileSize) * sampleSize;
+				file.write((const char*)src + row, (std::streamsize)(tw * sampleSize));
+			}
+		}
+	}
+
+	file.write(PADDING, (std::streamsize)(header.fileSize - (uint64_t)file.tellp()));
+
+	if (!file) {
+		std::cout << "COULD NOT WRITE THE HEIGHTMAP FILE: " << path << std::endl;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "heightmap.hpp"
+
+/*
+	.hmap: raw tiled heightfield container meant to be memory mapped.
+
+	  HmapHeader                      (64 bytes)
+	  uint64_t offsets[tilesY][tilesX] (absolute file offsets of every tile)
+	  tile data                       (each tile row-major, tileWidth x tileHeight
+	                                   samples, starting on a 64 byte boundary)
+
+	Tiles on the right and bottom edge are cut to the map size. Samples are
+	stored exactly like Heightmap (R16 unorm or R32F), little endian, so a tile
+	pointer into the mapping can be handed to glTexSubImage2D as is.
+*/
+
+static const char HMAP_MAGIC[4] = { 'H', 'M', 'A', 'P' };
+static const uint32_t HMAP_VERSION = 1;
+static const int HMAP_DEFAULT_TILE_SIZE = 256;
+
+struct HmapHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t format;      // HEIGHT_FORMAT
+	uint32_t tileSize;
+	uint32_t tilesX;
+	uint32_t tilesY;
+	uint64_t tableOffset; // where the tile offset table starts
+	uint64_t fileSize;
+	uint8_t reserved[16];
+};
+static_assert(sizeof(HmapHeader) == 64, "HmapHeader is written to disk as is");
+
+// read-only memory mapping of a whole file
+class MappedFile {
+private:
+	const unsigned char* m_data = nullptr;
+	size_t m_size = 0;
+#ifdef _WIN32
+	void* m_file = nullptr;
+	void* m_mapping = nullptr;
+#endif
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool open(const std::string& path);
+	void close();
+
+	const unsigned char* data() const;
+	size_t size() const;
+};
+
+class HeightmapFile {
+private:
+	MappedFile m_file;
+	const HmapHeader* m_header = nullptr;
+	const uint64_t* m_offsets = nullptr;
+public:
+	// maps the file and validates header and offset table; prints the reason and returns false on failure
+	bool open(const std::string& path);
+
+	int width() const;
+	int height() const;
+	HEIGHT_FORMAT format() const;
+	int tileSize() const;
+	int tilesX() const;
+	int tilesY() const;
+
+	int tileWidth(int tx) const;
+	int tileHeight(int ty) const;
+
+	// pointer into the mapping, no copy and no decoding
+	const void* tile(int tx, int ty) const;
+
+	// normalized height in [0, 1] of texel (x, y), read from its tile
+	float sample(int x, int y) const;
+
+	// copies the tiles back into a row-major Heightmap
+	Heightmap toHeightmap() const;
+
+	static bool write(const std::string& path, const Heightmap& heightmap, int tileSize = HMAP_DEFAULT_TILE_SIZE);
+};
@@ -0,0 +1,37 @@
+#include <iostream>
+#include <string>
+
+#include "heightmap.hpp"
+#include "heightmap_file.hpp"
+
+/*
+	Converts any heightmap Heightmap::load understands (PNG, .hdr, .r16, .r32)
+	into a memory mappable .hmap file.
+
+	usage: hmap_convert <input> <output.hmap> [tile size]
+*/
+int main(int argc, char** argv) {
+	if (argc < 3) {
+		std::cout << "usage: " << argv[0] << " <input> <output.hmap> [tile size]" << std::endl;
+		return -1;
+	}
+
+	int tileSize = argc > 3 ? std::stoi(argv[3]) : HMAP_DEFAULT_TILE_SIZE;
+	if (tileSize <= 0) {
+		std::cout << "INVALID TILE SIZE: " << tileSize << std::endl;
+		return -1;
+	}
+
+	Heightmap heightmap;
+	if (!heightmap.load(argv[1])) {
+		return -1;
+	}
+
+	if (!HeightmapFile::write(argv[2], heightmap, tileSize)) {
+		return -1;
+	}
+
+	std::cout << argv[1] << " -> " << argv[2] << " (" << heightmap.width() << "x" << heightmap.height()
+		<< (heightmap.format() == HEIGHT_R16 ? " R16" : " R32F") << ", " << tileSize << " px tiles)" << std::endl;
+	return 0;
+}
@@ -0,0 +1,192 @@
+#include "image_write.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// largest stored deflate block
+static const size_t MAX_STORED_BLOCK = 65535;
+
+static const uint32_t* crcTable() {
+	static const std::vector<uint32_t> table = []() {
+		std::vector<uint32_t> t(256);
+		for (uint32_t n = 0; n < 256; n++) {
+			uint32_t c = n;
+			for (int k = 0; k < 8; k++) {
+				c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+			}
+			t[n] = c;
+		}
+		return t;
+	}();
+	return table.data();
+}
+
+static void putBigEndian(unsigned char* out, uint32_t value) {
+	out[0] = (unsigned char)(value >> 24);
+	out[1] = (unsigned char)(value >> 16);
+	out[2] = (unsigned char)(value >> 8);
+	out[3] = (unsigned char)value;
+}
+
+/*
+	Streams the body of a chunk, keeping its CRC, and the zlib stream
+	inside IDAT: the pixel rows are cut into stored blocks as they come in
+	and the Adler-32 of the rows is kept for the trailer.
+*/
+class ChunkStream {
+private:
+	std::ofstream& m_file;
+	uint32_t m_crc = 0xffffffffu;
+	uint32_t m_adlerA = 1, m_adlerB = 0;
+	size_t m_rawLeft = 0;   // row bytes still to come
+	size_t m_blockLeft = 0; // of the current stored block
+public:
+	ChunkStream(std::ofstream& file, const char type[4]) : m_file(file) {
+		put((const unsigned char*)type, 4);
+	}
+
+	void put(const unsigned char* bytes, size_t count) {
+		const uint32_t* table = crcTable();
+		uint32_t crc = m_crc;
+		for (size_t i = 0; i < count; i++) {
+			crc = table[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+		}
+		m_crc = crc;
+		m_file.write((const char*)bytes, (std::streamsize)count);
+	}
+
+	void beginZlib(size_t rawBytes) {
+		// deflate, 32K window, no preset dictionary, check bits making the header a multiple of 31
+		const unsigned char header[2] = { 0x78, 0x01 };
+		put(header, 2);
+		m_rawLeft = rawBytes;
+	}
+
+	void putRaw(const unsigned char* bytes, size_t count) {
+		while (count > 0) {
+			if (m_blockLeft == 0) {
+				size_t length = std::min(m_rawLeft, MAX_STORED_BLOCK);
+				unsigned char block[5] = {
+					(unsigned char)(length == m_rawLeft ? 1 : 0),
+					(unsigned char)length, (unsigned char)(length >> 8),
+					(unsigned char)~length, (unsigned char)(~length >> 8)
+				};
+				put(block, 5);
+				m_blockLeft = length;
+			}
+
+			size_t take = std::min(count, m_blockLeft);
+			put(bytes, take);
+
+			// 5552 bytes is the most the sums can take before they overflow 32 bits
+			for (size_t done = 0; done < take;) {
+				size_t run = std::min(take - done, (size_t)5552);
+				for (size_t i = 0; i < run; i++) {
+					m_adlerA += bytes[done + i];
+					m_adlerB += m_adlerA;
+				}
+				m_adlerA %= 65521;
+				m_adlerB %= 65521;
+				done += run;
+			}
+
+			bytes += take;
+			count -= take;
+			m_blockLeft -= take;
+			m_rawLeft -= take;
+		}
+	}
+
+	void endZlib() {
+		unsigned char adler[4];
+		putBigEndian(adler, (m_adlerB << 16) | m_adlerA);
+		put(adler, 4);
+	}
+
+	void end() {
+		unsigned char crc[4];
+		putBigEndian(crc, m_crc ^ 0xffffffffu);
+		m_file.write((const char*)crc, 4);
+	}
+};
+
+static void writeChunkLength(std::ofstream& file, size_t length) {
+	unsigned char bytes[4];
+	putBigEndian(bytes, (uint32_t)length);
+	file.write((const char*)bytes, 4);
+}
+
+bool writePNG(const std::string& path, const void* pixels, int width, int height, int channels, int bitDepth) {
+	static const unsigned char COLOR_TYPES[5] = { 0, 0, 4, 2, 6 };
+	if (width <= 0 || height <= 0 || channels < 1 || channels > 4 || (bitDepth != 8 && bitDepth != 16)) {
+		std::cout << "UNSUPPORTED PNG LAYOUT: " << width << "x" << height << ", " << channels << " channels, "
+			<< bitDepth << " bit" << std::endl;
+		return false;
+	}
+
+	size_t sampleBytes = (size_t)bitDepth / 8;
+	size_t rowBytes = (size_t)width * channels * sampleBytes;
+	// every row starts with its filter type
+	size_t rawBytes = (rowBytes + 1) * height;
+	size_t blocks = (rawBytes + MAX_STORED_BLOCK - 1) / MAX_STORED_BLOCK;
+	size_t idatBytes = 2 + blocks * 5 + rawBytes + 4;
+	if (idatBytes > 0x7fffffffu) {
+		std::cout << "IMAGE TOO LARGE FOR ONE PNG: " << path << std::endl;
+		return false;
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file) {
+		std::cout << "COULD NOT WRITE THE IMAGE: " << path << std::endl;
+		return false;
+	}
+
+	const unsigned char SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	file.write((const char*)SIGNATURE, 8);
+
+	unsigned char header[13] = {};
+	putBigEndian(header, (uint32_t)width);
+	putBigEndian(header + 4, (uint32_t)height);
+	header[8] = (unsigned char)bitDepth;
+	header[9] = COLOR_TYPES[channels];
+	writeChunkLength(file, sizeof(header));
+	ChunkStream ihdr(file, "IHDR");
+	ihdr.put(header, sizeof(header));
+	ihdr.end();
+
+	writeChunkLength(file, idatBytes);
+	ChunkStream idat(file, "IDAT");
+	idat.beginZlib(rawBytes);
+
+	// filter type 0: the row as is, 16 bit samples big endian
+	std::vector<unsigned char> row(rowBytes + 1, 0);
+	for (int y = 0; y < height; y++) {
+		const unsigned char* src = (const unsigned char*)pixels + (size_t)y * rowBytes;
+		if (bitDepth == 8) {
+			std::copy(src, src + rowBytes, row.begin() + 1);
+		}
+		else {
+			const uint16_t* samples = (const uint16_t*)src;
+			for (size_t i = 0; i < rowBytes / 2; i++) {
+				row[1 + i * 2] = (unsigned char)(samples[i] >> 8);
+				row[2 + i * 2] = (unsigned char)samples[i];
+			}
+		}
+		idat.putRaw(row.data(), row.size());
+	}
+	idat.endZlib();
+	idat.end();
+
+	writeChunkLength(file, 0);
+	ChunkStream iend(file, "IEND");
+	iend.end();
+
+	if (!file) {
+		std::cout << "COULD NOT WRITE THE IMAGE: " << path << std::endl;
+		return false;
+	}
+	return true;
+}
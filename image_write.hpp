@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+
+/*
+	Writes a PNG with no dependencies beyond the standard library. The
+	image data goes into stored (uncompressed) deflate blocks, so files are
+	about the size of the raw pixels, but any PNG reader, stb_image
+	included, loads them.
+
+	pixels are width x height samples of channels interleaved components,
+	rows tightly packed. bitDepth 8 takes unsigned chars, 16 takes uint16_t
+	in host byte order. channels is 1 (grey), 2 (grey and alpha), 3 (RGB)
+	or 4 (RGBA). Prints the reason and returns false on failure.
+*/
+bool writePNG(const std::string& path, const void* pixels, int width, int height, int channels, int bitDepth);
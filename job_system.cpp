@@ -0,0 +1,181 @@
+#include "job_system.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+// queue owned by the current thread, or -1 outside of the pool
+static thread_local int t_workerIndex = -1;
+static thread_local const JobSystem* t_workerPool = nullptr;
+
+JobSystem::JobSystem(unsigned threadCount) {
+	if (threadCount == 0) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	for (unsigned i = 0; i < threadCount; i++) {
+		m_queues.emplace_back(std::make_unique<Queue>());
+	}
+
+	// the thread calling wait() works too, so one fewer worker than queues
+	for (unsigned i = 1; i < threadCount; i++) {
+		m_threads.emplace_back(&JobSystem::workerLoop, this, i);
+	}
+}
+
+JobSystem::~JobSystem() {
+	wait();
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_running = false;
+	}
+	m_wake.notify_all();
+	for (std::thread& t : m_threads) {
+		t.join();
+	}
+}
+
+unsigned JobSystem::threadCount() const {
+	return (unsigned)m_queues.size();
+}
+
+void JobSystem::push(unsigned queue, std::function<void()> job) {
+	m_pending.fetch_add(1, std::memory_order_relaxed);
+	{
+		Queue& q = *m_queues[queue];
+		std::lock_guard<std::mutex> lock(q.mutex);
+		q.jobs.emplace_back(std::move(job));
+	}
+	{
+		// a worker that scanned the queues before this job landed sees the count move and does not sleep
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_pushes.fetch_add(1, std::memory_order_release);
+	}
+	m_wake.notify_one();
+}
+
+void JobSystem::submit(std::function<void()> job) {
+	unsigned queue;
+	if (t_workerPool == this && t_workerIndex >= 0) {
+		queue = (unsigned)t_workerIndex;
+	}
+	else {
+		queue = m_nextQueue.fetch_add(1, std::memory_order_relaxed) % threadCount();
+	}
+	push(queue, std::move(job));
+}
+
+bool JobSystem::runOne(unsigned home) {
+	std::function<void()> job;
+
+	{
+		Queue& own = *m_queues[home];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.jobs.empty()) {
+			job = std::move(own.jobs.back());
+			own.jobs.pop_back();
+		}
+	}
+
+	for (unsigned i = 1; !job && i < threadCount(); i++) {
+		Queue& victim = *m_queues[(home + i) % threadCount()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.jobs.empty()) {
+			job = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+		}
+	}
+
+	if (!job) {
+		return false;
+	}
+
+	job();
+
+	if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_done.notify_all();
+	}
+	return true;
+}
+
+void JobSystem::workerLoop(unsigned index) {
+	t_workerIndex = (int)index;
+	t_workerPool = this;
+
+	while (true) {
+		// read before the scan: any job pushed after it bumps the count, any job pushed before it is found
+		uint64_t seen = m_pushes.load(std::memory_order_acquire);
+		if (runOne(index)) {
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_wake.wait(lock, [this, seen]() {
+			return !m_running || m_pushes.load(std::memory_order_relaxed) != seen;
+		});
+		if (!m_running) {
+			return;
+		}
+	}
+}
+
+void JobSystem::wait() {
+	unsigned home = (t_workerPool == this && t_workerIndex >= 0) ? (unsigned)t_workerIndex : 0;
+
+	while (m_pending.load(std::memory_order_acquire) > 0) {
+		if (runOne(home)) {
+			continue;
+		}
+
+		// nothing left to steal, the remaining jobs are running on other threads
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_done.wait_for(lock, std::chrono::milliseconds(1), [this]() {
+			return m_pending.load(std::memory_order_acquire) == 0;
+		});
+	}
+}
+
+bool JobSystem::runPending() {
+	unsigned home = (t_workerPool == this && t_workerIndex >= 0) ? (unsigned)t_workerIndex : 0;
+	return runOne(home);
+}
+
+void JobSystem::parallelFor(int count, const std::function<void(int)>& fn) {
+	if (count <= 0) {
+		return;
+	}
+
+	// only this batch is waited on, unrelated background jobs may keep running
+	std::atomic<int> remaining{ count };
+	auto run = [this, &fn, &remaining](int i) {
+		fn(i);
+		// the waiter may return as soon as the count hits zero, so nothing in this closure is touched after it
+		JobSystem* self = this;
+		if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			std::lock_guard<std::mutex> lock(self->m_sleepMutex);
+			self->m_done.notify_all();
+		}
+	};
+
+	unsigned queues = threadCount();
+	for (unsigned q = 0; q < queues; q++) {
+		int begin = (int)((long long)count * q / queues);
+		int end = (int)((long long)count * (q + 1) / queues);
+		// pushed back to front, the owner pops from the back and walks its block in order
+		for (int i = end - 1; i >= begin; i--) {
+			push(q, [&run, i]() { run(i); });
+		}
+	}
+
+	unsigned home = (t_workerPool == this && t_workerIndex >= 0) ? (unsigned)t_workerIndex : 0;
+	while (remaining.load(std::memory_order_acquire) > 0) {
+		if (runOne(home)) {
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_done.wait_for(lock, std::chrono::milliseconds(1), [&remaining]() {
+			return remaining.load(std::memory_order_acquire) == 0;
+		});
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+	Work-stealing thread pool.
+
+	Every worker owns a deque: it pops its own jobs from the back (most
+	recently pushed, still warm in cache) and, once empty, steals from the
+	front of the other workers' deques. Threads that call wait() help run
+	jobs instead of blocking.
+*/
+class JobSystem {
+private:
+	struct Queue {
+		std::mutex mutex;
+		std::deque<std::function<void()>> jobs;
+	};
+
+	std::vector<std::unique_ptr<Queue>> m_queues;
+	std::vector<std::thread> m_threads;
+	std::atomic<bool> m_running{ true };
+	std::atomic<int> m_pending{ 0 };
+	std::atomic<unsigned> m_nextQueue{ 0 };
+
+	std::mutex m_sleepMutex;
+	// bumped under m_sleepMutex by every push, so a worker can tell whether anything arrived since it last looked
+	std::atomic<uint64_t> m_pushes{ 0 };
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+
+	void workerLoop(unsigned index);
+	bool runOne(unsigned home);
+	void push(unsigned queue, std::function<void()> job);
+public:
+	// 0 threads means one per hardware thread
+	explicit JobSystem(unsigned threadCount = 0);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	void submit(std::function<void()> job);
+
+	// runs pending jobs on the calling thread until every submitted job has finished
+	void wait();
+
+	/*
+		Calls fn(i) for i in [0, count) and returns once all calls are done.
+		The range is dealt out in contiguous blocks, one per worker queue, so
+		neighbouring items start on the same thread and stealing evens out the rest.
+	*/
+	void parallelFor(int count, const std::function<void(int)>& fn);
+
+	/*
+		Runs at most one pending job on the calling thread and returns whether
+		it did. Lets a pool without worker threads (threadCount() == 1) make
+		progress on background jobs without blocking in wait().
+	*/
+	bool runPending();
+
+	unsigned threadCount() const;
+};
@@ -1,6 +1,10 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <charconv>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <string_view>
 #include "geometry.hpp"
 #include "shader.hpp"
 
@@ -8,7 +12,18 @@
 #include <glm/ext/matrix_clip_space.hpp>
 #include <glm/ext/matrix_transform.hpp>
 #include "camera.hpp"
-#include "stb_image.hpp"
+#include "chunk_manager.hpp"
+#include "erosion.hpp"
+#include "frame_uniforms.hpp"
+#include "heightmap.hpp"
+#include "heightmap_file.hpp"
+#include "height_pyramid.hpp"
+#include "height_pyramid_texture.hpp"
+#include "height_tiles.hpp"
+#include "job_system.hpp"
+#include "noise.hpp"
+#include "patch_grid.hpp"
+#include "profiler.hpp"
 
 using glm::vec3, glm::mat4, std::vector;
 
@@ -48,7 +63,72 @@ static void gatherComputeInfo() {
 	std::cout << "Max invocations count per work group: " << workGroupInv << '\n';
 }
 
-int main(void) {
+/*
+	Single channel upload, the shaders only ever read .r. A fixed heightmap
+	goes into layer 0 of a one layer array so it is drawn with the same
+	shaders as the streamed chunks.
+*/
+static void uploadHeightmap(const Heightmap& heightmap) {
+	GLenum internalFormat = heightmap.format() == HEIGHT_R16 ? GL_R16 : GL_R32F;
+	GLenum type = heightmap.format() == HEIGHT_R16 ? GL_UNSIGNED_SHORT : GL_FLOAT;
+
+	// R16 rows of odd width are not 4 byte aligned
+	glPixelStorei(GL_UNPACK_ALIGNMENT, (GLint)heightFormatSize(heightmap.format()));
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, internalFormat, heightmap.width(), heightmap.height(), 1, 0,
+		GL_RED, type, heightmap.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+// uploads straight out of the file mapping, one glTexSubImage3D per tile
+static void uploadHeightmap(const HeightmapFile& file) {
+	GLenum internalFormat = file.format() == HEIGHT_R16 ? GL_R16 : GL_R32F;
+	GLenum type = file.format() == HEIGHT_R16 ? GL_UNSIGNED_SHORT : GL_FLOAT;
+
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, internalFormat, file.width(), file.height(), 1, 0, GL_RED, type, NULL);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, (GLint)heightFormatSize(file.format()));
+	for (int ty = 0; ty < file.tilesY(); ty++) {
+		for (int tx = 0; tx < file.tilesX(); tx++) {
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, tx * file.tileSize(), ty * file.tileSize(), 0,
+				file.tileWidth(tx), file.tileHeight(ty), 1, GL_RED, type, file.tile(tx, ty));
+		}
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+int main(int argc, char** argv) {
+	// --profile <path> may go anywhere, the zones are written there on exit (.csv statistics, otherwise a Chrome trace)
+	std::string profilePath;
+	for (int i = 1; i + 1 < argc; i++) {
+		if (std::string(argv[i]) == "--profile") {
+			profilePath = argv[i + 1];
+			for (int j = i; j + 2 < argc; j++) {
+				argv[j] = argv[j + 2];
+			}
+			argc -= 2;
+			break;
+		}
+	}
+	if (!profilePath.empty()) {
+#ifdef TERRAIN_PROFILE
+		Profiler::instance().setEnabled(true);
+#else
+		std::cout << "PROFILING IS COMPILED OUT, BUILD WITH TERRAIN_PROFILE DEFINED" << std::endl;
+		profilePath.clear();
+#endif
+	}
+
+	/*
+		Erosion needs the whole map at once: droplets cross chunk borders, so
+		eroding each streamed chunk on its own would leave seams. The endless
+		generated terrain is never eroded, bake an eroded map with
+		terrain-bake --erode and open that instead.
+	*/
+	if (argc > 1 && std::string(argv[1]) == "--erode") {
+		std::cout << "EROSION NEEDS A HEIGHTMAP: BAKE AN ERODED ONE WITH terrain-bake --erode AND PASS IT IN" << std::endl;
+		return -1;
+	}
+
 	glfwInit();
 	glfwWindowHint(GLFW_SAMPLES, 4);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
@@ -76,92 +156,164 @@ int main(void) {
 		return -1;
 	}
 
+	JobSystem jobs;
+
 	glEnable(GL_DEPTH_TEST);
 	glEnable(GL_MULTISAMPLE);
 
-	unsigned int heightMapTexture;
-	glGenTextures(1, &heightMapTexture);
-	glBindTexture(GL_TEXTURE_2D, heightMapTexture);
-	// set the texture wrapping/filtering options (on the currently bound texture object)
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	int width, height, nrChannels;
-	unsigned char* data = stbi_load("./textures/heightmap.png", &width, &height, &nrChannels, 0);
-
-	if (!data) {
-		std::cout << "COULD NOT LOAD THE HEIGHTMAP: " << stbi_failure_reason() << std::endl;
-		stbi_image_free(data);
-		return -1;
-	}
-
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-	stbi_image_free(data);
-
+	// the programs compile in the background while the first frames go out
+	Shader::enableParallelCompile();
+	double shaderStart = glfwGetTime();
 	Shader base("./shaders/vertex_base.glsl", "./shaders/fragment_base.glsl",
 		"./shaders/tess_control.glsl", "./shaders/tess_eval.glsl");
+	bool shadersReady = false;
 
-	mat4 projection = mat4(1.0f), view = mat4(1.0f), model = mat4(1.0f);
+	mat4 projection = mat4(1.0f), model = mat4(1.0f);
 	projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 200.f);
 
-	base.use();
-	base.setMat4("projection", projection);
-	base.setMat4("view", view);
-	base.setMat4("model", model);
-	base.setInt("heightMap", 0);
+	// per-frame matrices live in a uniform buffer shared by every program
+	FrameUniforms frame;
+	// triangles per framebuffer pixel, so the density on screen holds at any resolution
+	frame.setTrianglesPerPixel(0.1f);
 
+	glPatchParameteri(GL_PATCH_VERTICES, 4);
+
+	/*
+		A heightmap passed on the command line is drawn as one fixed grid,
+		otherwise the terrain is generated in chunks around the camera as it
+		moves.
+	*/
 	const int REZ = 20;
-	std::vector<GLfloat> vertices;
-	vertices.reserve(REZ * REZ * REZ);
-	for (int i = 0; i < REZ; i++) {
-		for (int j = 0; j < REZ; j++) {
-			vertices.emplace_back(-width / 2.0f + width * i / (float)REZ); // v.x
-			vertices.emplace_back(0.0f); // v.y 
-			vertices.emplace_back(-height / 2.0f + height * j / (float)REZ); // v.z
-			vertices.emplace_back(i / (float)REZ); //u
-			vertices.emplace_back(j / (float)REZ); // v
-
-			vertices.emplace_back(-width / 2.0f + width * (i + 1) / (float)REZ); // v.x
-			vertices.emplace_back(0.0f); // v.y 
-			vertices.emplace_back(-height / 2.0f + height * j / (float)REZ); // v.z
-			vertices.emplace_back((i + 1) / (float)REZ); //u
-			vertices.emplace_back(j / (float)REZ); // v
-
-			vertices.emplace_back(-width / 2.0f + width * i / (float)REZ); // v.x
-			vertices.emplace_back(0.0f); // v.y 
-			vertices.emplace_back(-height / 2.0f + height * (j + 1) / (float)REZ); // v.z
-			vertices.emplace_back(i / (float)REZ); //u
-			vertices.emplace_back((j + 1) / (float)REZ); // v
-
-			vertices.emplace_back(-width / 2.0f + width * (i + 1) / (float)REZ); // v.x
-			vertices.emplace_back(0.0f); // v.y 
-			vertices.emplace_back(-height / 2.0f + height * (j + 1) / (float)REZ); // v.z
-			vertices.emplace_back((i + 1) / (float)REZ); //u
-			vertices.emplace_back((j + 1) / (float)REZ); // v
+	unsigned int heightMapTexture = 0;
+	GLuint terrainVAO = 0, terrainVBO = 0;
+	Heightmap heightmap;
+	HeightmapFile heightmapFile;
+	HeightTiles fixedGround;
+	HeightPyramid fixedPyramid;
+	HeightPyramidTexture fixedPyramidTexture;
+	std::unique_ptr<ChunkManager> chunks;
+
+	if (argc > 1) {
+		glGenTextures(1, &heightMapTexture);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, heightMapTexture);
+		// set the texture wrapping/filtering options (on the currently bound texture object)
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		int width, height;
+		HEIGHT_FORMAT format;
+		std::function<float(int, int)> sample;
+		bool mapped = std::string(argv[1]).ends_with(".hmap");
+		if (mapped) {
+			if (!heightmapFile.open(argv[1])) {
+				glfwTerminate();
+				return -1;
+			}
+			width = heightmapFile.width();
+			height = heightmapFile.height();
+			format = heightmapFile.format();
+			sample = [&heightmapFile](int x, int y) { return heightmapFile.sample(x, y); };
+		}
+		else {
+			if (!heightmap.load(argv[1])) {
+				glfwTerminate();
+				return -1;
+			}
+			width = heightmap.width();
+			height = heightmap.height();
+			format = heightmap.format();
+			sample = [&heightmap](int x, int y) { return heightmap.sample(x, y); };
 		}
-	}
 
-	GLuint terrainVAO, terrainVBO, terrainEBO;
-	glGenVertexArrays(1, &terrainVAO);
-	glGenBuffers(1, &terrainVBO);
-	glGenBuffers(1, &terrainEBO);
+		// --erode [droplets] runs hydraulic erosion over the heights before they go up, then thermal erosion slumps
+		// the banks the droplets cut steeper than the talus. Only a loaded map erodes, the streamed chunks never do
+		if (argc > 2 && std::string(argv[2]) == "--erode") {
+			HydraulicParams erosion;
+			erosion.droplets = width * height / 4;
+			if (argc > 3) {
+				// the whole argument has to be the count, "1e6" is not a million droplets
+				std::string_view value = argv[3];
+				auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), erosion.droplets);
+				if (error != std::errc() || end != value.data() + value.size() || erosion.droplets < 0) {
+					std::cout << "INVALID DROPLET COUNT: " << value << std::endl;
+					glfwTerminate();
+					return -1;
+				}
+			}
+
+			std::vector<float> heights((size_t)width * height);
+			for (int y = 0; y < height; y++) {
+				for (int x = 0; x < width; x++) {
+					heights[(size_t)y * width + x] = sample(x, y);
+				}
+			}
+
+			double erosionStart = glfwGetTime();
+			erodeHydraulic(jobs, heights.data(), width, height, erosion);
+			std::cout << "Hydraulic erosion: " << erosion.droplets << " droplets in "
+				<< (glfwGetTime() - erosionStart) * 1000.0 << " ms\n";
+
+			ThermalParams thermal;
+			erosionStart = glfwGetTime();
+			erodeThermal(jobs, heights.data(), width, height, thermal);
+			std::cout << "Thermal erosion: " << thermal.iterations << " iterations in "
+				<< (glfwGetTime() - erosionStart) * 1000.0 << " ms\n";
+
+			// the eroded copy replaces whatever was loaded
+			heightmap = Heightmap::fromFloats(heights.data(), width, height, format);
+			mapped = false;
+			sample = [&heightmap](int x, int y) { return heightmap.sample(x, y); };
+		}
 
-	glBindVertexArray(terrainVAO);
+		if (mapped) {
+			uploadHeightmap(heightmapFile);
+		}
+		else {
+			uploadHeightmap(heightmap);
+		}
 
-	glBindBuffer(GL_ARRAY_BUFFER, terrainVBO);
-	glBufferData(GL_ARRAY_BUFFER,
-		vertices.size() * sizeof(float),       // size of vertices buffer
-		vertices.data(),                          // pointer to first element
-		GL_STATIC_DRAW);
+		// texel (0, 0) sits half a texel in from the grid corner
+		fixedGround = HeightTiles(128, glm::vec2(0.5f - width / 2.0f, 0.5f - height / 2.0f));
+		fixedGround.build(width, height, format, sample);
 
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glPatchParameteri(GL_PATCH_VERTICES, 4);
+		// patch bounds come from the min/max pyramid. Its GL_RG16 copy stays resident for GPU side bound queries,
+		// the shaders do not read it yet
+		fixedPyramid.build(mapped ? heightmapFile.toHeightmap() : heightmap);
+		fixedPyramidTexture.upload(fixedPyramid);
+		fixedPyramid.clearDirty();
+
+		std::vector<glm::vec2> bounds((size_t)REZ * REZ);
+		patchHeightBounds(bounds.data(), glm::vec2(0.0f), glm::vec2(1.0f), REZ, fixedPyramid);
+		std::vector<PatchRoughness> roughness((size_t)REZ * REZ);
+		patchRoughness(roughness.data(), glm::vec2(0.0f), glm::vec2(1.0f), REZ, width, height, sample);
+
+		std::vector<GLfloat> vertices(patchGridFloats(REZ));
+		writePatchGrid(vertices.data(), glm::vec2(-width / 2.0f, -height / 2.0f), glm::vec2(width, height),
+			glm::vec2(0.0f), glm::vec2(1.0f), REZ, bounds.data(), roughness.data());
+
+		glGenVertexArrays(1, &terrainVAO);
+		glGenBuffers(1, &terrainVBO);
+
+		glBindVertexArray(terrainVAO);
+
+		glBindBuffer(GL_ARRAY_BUFFER, terrainVBO);
+		glBufferData(GL_ARRAY_BUFFER,
+			vertices.size() * sizeof(float),       // size of vertices buffer
+			vertices.data(),                          // pointer to first element
+			GL_STATIC_DRAW);
+
+		setPatchVertexLayout();
+	}
+	else {
+		FractalParams params;
+		params.octaves = 8;
+		params.quantizeLevels = 65535; // stored as R16
+		FractalNoise fbm(PerlinNoise(1337), params);
+
+		chunks = std::make_unique<ChunkManager>(jobs, fbm);
+	}
 
 	gatherComputeInfo();
 
@@ -170,25 +322,76 @@ int main(void) {
 	float last = glfwGetTime();
 	float dt = 0.00001;
 	while (!glfwWindowShouldClose(window)) {
+		PROFILE_FRAME();
 		float current = glfwGetTime();
 		dt = current - last;
 		last = current;
 
 		processInput(window, dt);
 
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		if (chunks) {
+			PROFILE_GPU_SCOPE("chunk uploads");
+			chunks->update(camera.m_pos);
+		}
 
-		base.use();
-		base.setMat4("view", camera.getViewMatrix());
-		glBindTexture(GL_TEXTURE_2D, heightMapTexture);
-		glBindVertexArray(terrainVAO);
-		glDrawArrays(GL_PATCHES, 0, 4 * REZ * REZ);
+		// nothing to stand on until the chunk under the camera has streamed in
+		const HeightTiles& ground = chunks ? chunks->ground() : fixedGround;
+		float groundHeight;
+		if (camera.walking() && ground.heightAt(camera.m_pos.x, camera.m_pos.z, groundHeight)) {
+			camera.followGround(groundHeight, dt);
+		}
+
+		{
+			PROFILE_GPU_SCOPE("clear");
+			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		}
+
+		if (!shadersReady && base.ready()) {
+			shadersReady = true;
+			std::cout << "Shader setup: " << (glfwGetTime() - shaderStart) * 1000.0 << " ms ("
+				<< (base.loadedFromCache() ? "program binary cache" : "compiled") << ")\n";
 
-		glfwSwapBuffers(window);
+			base.use();
+			base.setInt("heightMap", 0);
+			base.setInt("heightLayer", 0);
+		}
+
+		if (shadersReady) {
+			PROFILE_GPU_SCOPE("terrain");
+			int framebufferWidth, framebufferHeight;
+			glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+			frame.setViewport(framebufferWidth, framebufferHeight);
+			frame.update(projection, camera.getViewMatrix(), model);
+
+			base.use();
+			if (chunks) {
+				chunks->draw(base);
+			}
+			else {
+				glBindTexture(GL_TEXTURE_2D_ARRAY, heightMapTexture);
+				glBindVertexArray(terrainVAO);
+				glDrawArrays(GL_PATCHES, 0, 4 * REZ * REZ);
+			}
+		}
+
+		{
+			// waits for vsync or for the GPU to drain its queue
+			PROFILE_SCOPE("swap buffers");
+			glfwSwapBuffers(window);
+		}
 		glfwPollEvents();
 	}
 
+	if (!profilePath.empty()) {
+		Profiler::instance().printSummary();
+		Profiler::instance().write(profilePath);
+	}
+
+	// the chunk textures and buffers, the pyramid texture and the timer queries go before the context does
+	Profiler::instance().releaseGpu();
+	chunks.reset();
+	fixedPyramidTexture.destroy();
 	glfwTerminate();
 	return 0;
 }
@@ -211,6 +414,15 @@ void processInput(GLFWwindow* window, float dt) {
 
 	Camera* camera = (Camera*)glfwGetWindowUserPointer(window);
 
+	// G toggles between flying and walking on the terrain, once per press
+	static bool walkKeyDown = false;
+	bool walkKey = glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS;
+	if (walkKey && !walkKeyDown) {
+		camera->setWalking(!camera->walking());
+		std::cout << (camera->walking() ? "Walking" : "Flying") << '\n';
+	}
+	walkKeyDown = walkKey;
+
 	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
 		camera->move(FORWARD, dt);
 	}
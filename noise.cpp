@@ -0,0 +1,146 @@
+#include "noise.hpp"
+#include "noise_simd.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+
+// the 8 gradient directions, indexed by the low 3 bits of the corner hash
+const float PERLIN_GRAD_X[8] = { 1.0f, -1.0f,  1.0f, -1.0f, 1.0f, -1.0f, 0.0f,  0.0f };
+const float PERLIN_GRAD_Y[8] = { 1.0f,  1.0f, -1.0f, -1.0f, 0.0f,  0.0f, 1.0f, -1.0f };
+
+static uint32_t splitmix32(uint32_t& state) {
+	uint32_t z = (state += 0x9E3779B9u);
+	z = (z ^ (z >> 16)) * 0x85EBCA6Bu;
+	z = (z ^ (z >> 13)) * 0xC2B2AE35u;
+	return z ^ (z >> 16);
+}
+
+static inline int fastFloor(float x) {
+	int i = (int)x;
+	return x < (float)i ? i - 1 : i;
+}
+
+static inline float fade(float t) {
+	return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+static inline float lerp(float a, float b, float t) {
+	return a + t * (b - a);
+}
+
+static inline float grad(int hash, float x, float y) {
+	int h = hash & 7;
+	return PERLIN_GRAD_X[h] * x + PERLIN_GRAD_Y[h] * y;
+}
+
+PerlinNoise::PerlinNoise(uint32_t seed) {
+	reseed(seed);
+}
+
+void PerlinNoise::reseed(uint32_t seed) {
+	m_seed = seed;
+
+	for (int i = 0; i < 256; i++) {
+		m_perm[i] = i;
+	}
+
+	uint32_t state = seed;
+	for (int i = 255; i > 0; i--) {
+		int j = (int)(splitmix32(state) % (uint32_t)(i + 1));
+		std::swap(m_perm[i], m_perm[j]);
+	}
+
+	for (int i = 0; i < 256; i++) {
+		m_perm[256 + i] = m_perm[i];
+	}
+}
+
+uint32_t PerlinNoise::seed() const {
+	return m_seed;
+}
+
+const int32_t* PerlinNoise::permutation() const {
+	return m_perm;
+}
+
+float PerlinNoise::noise(float x, float y) const {
+	int xi = fastFloor(x);
+	int yi = fastFloor(y);
+
+	float xf = x - (float)xi;
+	float yf = y - (float)yi;
+
+	xi &= 255;
+	yi &= 255;
+
+	/*  (xi, yi+1) --- (xi+1, yi+1)
+		|                 |
+		(xi, yi) ----- (xi+1, yi)
+	*/
+	int a = m_perm[xi] + yi;
+	int b = m_perm[xi + 1] + yi;
+
+	int h00 = m_perm[a];
+	int h10 = m_perm[b];
+	int h01 = m_perm[a + 1];
+	int h11 = m_perm[b + 1];
+
+	float u = fade(xf);
+	float v = fade(yf);
+
+	float x0 = lerp(grad(h00, xf, yf), grad(h10, xf - 1.0f, yf), u);
+	float x1 = lerp(grad(h01, xf, yf - 1.0f), grad(h11, xf - 1.0f, yf - 1.0f), u);
+
+	return lerp(x0, x1, v);
+}
+
+void PerlinNoise::noise8(const float* x, const float* y, float* out) const {
+	switch (simdLevel()) {
+	case SIMD_AVX2:
+		perlinNoise8AVX2(m_perm, x, y, out);
+		break;
+	case SIMD_SSE41:
+		perlinNoise8SSE41(m_perm, x, y, out);
+		break;
+	case SIMD_SSE2:
+		perlinNoise8SSE2(m_perm, x, y, out);
+		break;
+	default:
+		for (int i = 0; i < 8; i++) {
+			out[i] = noise(x[i], y[i]);
+		}
+		break;
+	}
+}
+
+void PerlinNoise::generate(float* out, int w, int h, glm::vec2 origin, float scale) const {
+	generateRegion(out, w, 0, 0, w, h, origin, scale);
+}
+
+void PerlinNoise::generateRegion(float* out, int stride, int x0, int y0, int w, int h, glm::vec2 origin, float scale) const {
+	float xs[8], ys[8], n[8];
+
+	for (int y = y0; y < y0 + h; y++) {
+		float sy = origin.y + (float)y * scale;
+		float* row = out + (size_t)y * stride;
+
+		for (int i = 0; i < 8; i++) {
+			ys[i] = sy;
+		}
+
+		int x = x0;
+		for (; x + 8 <= x0 + w; x += 8) {
+			for (int i = 0; i < 8; i++) {
+				xs[i] = origin.x + (float)(x + i) * scale;
+			}
+			noise8(xs, ys, n);
+			for (int i = 0; i < 8; i++) {
+				row[x + i] = std::clamp(n[i] * 0.5f + 0.5f, 0.0f, 1.0f);
+			}
+		}
+		for (; x < x0 + w; x++) {
+			float sx = origin.x + (float)x * scale;
+			row[x] = std::clamp(noise(sx, sy) * 0.5f + 0.5f, 0.0f, 1.0f);
+		}
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+
+/*
+	Classic 2D Perlin gradient noise (improved quintic fade).
+
+	The permutation table is built from the seed with a self-contained
+	PRNG + Fisher-Yates shuffle instead of std::shuffle, so the same seed
+	produces the same terrain on every standard library / compiler.
+*/
+class PerlinNoise {
+private:
+	// doubled so perm[perm[x] + y] never needs a second wrap; int so it can be gathered
+	int32_t m_perm[512];
+	uint32_t m_seed = 0;
+public:
+	explicit PerlinNoise(uint32_t seed = 0);
+
+	void reseed(uint32_t seed);
+	uint32_t seed() const;
+
+	// raw noise, roughly in [-1, 1]
+	float noise(float x, float y) const;
+
+	// noise() for 8 samples at once on the widest instruction set available (see simd.hpp)
+	void noise8(const float* x, const float* y, float* out) const;
+
+	/*
+		Fills out[y * w + x] with heights in [0, 1], sampling the noise at
+		origin + (x, y) * scale. This is the row-major single-channel buffer
+		the heightmap texture upload consumes.
+	*/
+	void generate(float* out, int w, int h, glm::vec2 origin, float scale) const;
+
+	/*
+		Same as generate() restricted to the w x h region starting at pixel
+		(x0, y0) of a buffer whose rows are stride floats apart. out points at
+		the buffer's first pixel, so tiles of a larger heightmap come out
+		identical to a single generate() over the whole map.
+	*/
+	void generateRegion(float* out, int stride, int x0, int y0, int w, int h, glm::vec2 origin, float scale) const;
+
+	const int32_t* permutation() const;
+};
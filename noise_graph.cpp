@@ -0,0 +1,116 @@
+#include "noise_graph.hpp"
+
+namespace noise_graph {
+
+	int NoiseGraph::push(const GraphNode& node) {
+		m_nodes.push_back(node);
+		return (int)m_nodes.size() - 1;
+	}
+
+	int NoiseGraph::constant(float value) {
+		GraphNode node{ NODE_CONSTANT };
+		node.params[0] = value;
+		return push(node);
+	}
+
+	int NoiseGraph::perlin(const PerlinNoise& noise, float frequency) {
+		GraphNode node{ NODE_PERLIN };
+		node.perlin = &noise;
+		node.params[0] = frequency;
+		return push(node);
+	}
+
+	int NoiseGraph::fractal(const FractalNoise& noise, float frequency) {
+		GraphNode node{ NODE_FRACTAL };
+		node.fractal = &noise;
+		node.params[0] = frequency;
+		return push(node);
+	}
+
+	int NoiseGraph::add(int a, int b) {
+		GraphNode node{ NODE_ADD };
+		node.inputs[0] = a;
+		node.inputs[1] = b;
+		return push(node);
+	}
+
+	int NoiseGraph::mul(int a, int b) {
+		GraphNode node{ NODE_MUL };
+		node.inputs[0] = a;
+		node.inputs[1] = b;
+		return push(node);
+	}
+
+	int NoiseGraph::clamp(int a, float lo, float hi) {
+		GraphNode node{ NODE_CLAMP };
+		node.inputs[0] = a;
+		node.params[0] = lo;
+		node.params[1] = hi;
+		return push(node);
+	}
+
+	int NoiseGraph::warp(int src, int wx, int wy, float strength) {
+		GraphNode node{ NODE_WARP };
+		node.inputs[0] = src;
+		node.inputs[1] = wx;
+		node.inputs[2] = wy;
+		node.params[0] = strength;
+		return push(node);
+	}
+
+	int NoiseGraph::curve(int a, const CurveTable& table) {
+		GraphNode node{ NODE_CURVE };
+		node.inputs[0] = a;
+		node.curve = table;
+		return push(node);
+	}
+
+	size_t NoiseGraph::size() const {
+		return m_nodes.size();
+	}
+
+	// same arithmetic, in the same order, as the eval() of the matching template node
+	float NoiseGraph::evalNode(int index, float x, float y) const {
+		const GraphNode& node = m_nodes[index];
+
+		switch (node.kind) {
+		case NODE_CONSTANT:
+			return node.params[0];
+		case NODE_PERLIN:
+			return node.perlin->noise(x * node.params[0], y * node.params[0]);
+		case NODE_FRACTAL:
+			return node.fractal->sample(x * node.params[0], y * node.params[0]);
+		case NODE_ADD:
+			return evalNode(node.inputs[0], x, y) + evalNode(node.inputs[1], x, y);
+		case NODE_MUL:
+			return evalNode(node.inputs[0], x, y) * evalNode(node.inputs[1], x, y);
+		case NODE_CLAMP:
+			return std::clamp(evalNode(node.inputs[0], x, y), node.params[0], node.params[1]);
+		case NODE_WARP: {
+			float dx = evalNode(node.inputs[1], x, y) * node.params[0];
+			float dy = evalNode(node.inputs[2], x, y) * node.params[0];
+			return evalNode(node.inputs[0], x + dx, y + dy);
+		}
+		case NODE_CURVE:
+			return node.curve.apply(evalNode(node.inputs[0], x, y));
+		}
+		return 0.0f;
+	}
+
+	float NoiseGraph::eval(float x, float y) const {
+		if (m_nodes.empty()) {
+			return 0.0f;
+		}
+		return evalNode((int)m_nodes.size() - 1, x, y);
+	}
+
+	void NoiseGraph::generateRegion(float* out, int stride, int x0, int y0, int w, int h, glm::vec2 origin, float scale) const {
+		for (int y = y0; y < y0 + h; y++) {
+			float sy = origin.y + (float)y * scale;
+			float* row = out + (size_t)y * stride;
+			for (int x = x0; x < x0 + w; x++) {
+				row[x] = eval(origin.x + (float)x * scale, sy);
+			}
+		}
+	}
+}
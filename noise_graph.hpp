@@ -0,0 +1,326 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <array>
+#include <initializer_list>
+#include <type_traits>
+#include <vector>
+
+#include "fractal.hpp"
+#include "noise.hpp"
+
+/*
+	Terrain recipes as expression templates.
+
+	A recipe such as
+
+		auto recipe = clampNode(curveNode(fbm + warpNode(ridged, perlin, perlin, 4.0f) * 0.3f, {...}), 0.0f, 1.0f);
+
+	is one concrete type, so generateRegion(recipe, ...) compiles into a single
+	inner loop with every node inlined: no virtual calls and no intermediate
+	buffers. Nodes work on groups of 8 samples so Perlin leaves run through
+	PerlinNoise::noise8. NoiseGraph below evaluates the same nodes from a
+	description built at runtime (recipe files, tools).
+
+	Leaves keep pointers to their noise objects, which have to outlive the recipe.
+*/
+namespace noise_graph {
+
+	// every node derives from Node so the operators below only pick up nodes
+	struct Node {};
+
+	template<class T>
+	constexpr bool isNode = std::is_base_of_v<Node, T>;
+
+	struct Constant : Node {
+		float value;
+
+		explicit Constant(float v) : value(v) {}
+
+		float eval(float, float) const {
+			return value;
+		}
+
+		void eval8(const float*, const float*, float* out) const {
+			for (int i = 0; i < 8; i++) out[i] = value;
+		}
+	};
+
+	// raw Perlin noise in [-1, 1] at frequency times the sample position
+	struct Perlin : Node {
+		const PerlinNoise* noise;
+		float frequency;
+
+		Perlin(const PerlinNoise& n, float f = 1.0f) : noise(&n), frequency(f) {}
+
+		float eval(float x, float y) const {
+			return noise->noise(x * frequency, y * frequency);
+		}
+
+		void eval8(const float* x, const float* y, float* out) const {
+			float xs[8], ys[8];
+			for (int i = 0; i < 8; i++) {
+				xs[i] = x[i] * frequency;
+				ys[i] = y[i] * frequency;
+			}
+			noise->noise8(xs, ys, out);
+		}
+	};
+
+	// FractalNoise height in [0, 1]
+	struct Fractal : Node {
+		const FractalNoise* noise;
+		float frequency;
+
+		Fractal(const FractalNoise& n, float f = 1.0f) : noise(&n), frequency(f) {}
+
+		float eval(float x, float y) const {
+			return noise->sample(x * frequency, y * frequency);
+		}
+
+		void eval8(const float* x, const float* y, float* out) const {
+			float xs[8], ys[8];
+			for (int i = 0; i < 8; i++) {
+				xs[i] = x[i] * frequency;
+				ys[i] = y[i] * frequency;
+			}
+			noise->sample8(xs, ys, out);
+		}
+	};
+
+	template<class A, class B>
+	struct Add : Node {
+		A a;
+		B b;
+
+		Add(const A& a_, const B& b_) : a(a_), b(b_) {}
+
+		float eval(float x, float y) const {
+			return a.eval(x, y) + b.eval(x, y);
+		}
+
+		void eval8(const float* x, const float* y, float* out) const {
+			float rhs[8];
+			a.eval8(x, y, out);
+			b.eval8(x, y, rhs);
+			for (int i = 0; i < 8; i++) out[i] = out[i] + rhs[i];
+		}
+	};
+
+	template<class A, class B>
+	struct Mul : Node {
+		A a;
+		B b;
+
+		Mul(const A& a_, const B& b_) : a(a_), b(b_) {}
+
+		float eval(float x, float y) const {
+			return a.eval(x, y) * b.eval(x, y);
+		}
+
+		void eval8(const float* x, const float* y, float* out) const {
+			float rhs[8];
+			a.eval8(x, y, out);
+			b.eval8(x, y, rhs);
+			for (int i = 0; i < 8; i++) out[i] = out[i] * rhs[i];
+		}
+	};
+
+	template<class A>
+	struct Clamp : Node {
+		A a;
+		float lo, hi;
+
+		Clamp(const A& a_, float l, float h) : a(a_), lo(l), hi(h) {}
+
+		float eval(float x, float y) const {
+			return std::clamp(a.eval(x, y), lo, hi);
+		}
+
+		void eval8(const float* x, const float* y, float* out) const {
+			a.eval8(x, y, out);
+			for (int i = 0; i < 8; i++) out[i] = std::clamp(out[i], lo, hi);
+		}
+	};
+
+	// samples src at (x, y) + strength * (wx(x, y), wy(x, y))
+	template<class Src, class WX, class WY>
+	struct Warp : Node {
+		Src src;
+		WX wx;
+		WY wy;
+		float strength;
+
+		Warp(const Src& s, const WX& x_, const WY& y_, float k) : src(s), wx(x_), wy(y_), strength(k) {}
+
+		float eval(float x, float y) const {
+			float dx = wx.eval(x, y) * strength;
+			float dy = wy.eval(x, y) * strength;
+			return src.eval(x + dx, y + dy);
+		}
+
+		void eval8(const float* x, const float* y, float* out) const {
+			float dx[8], dy[8];
+			wx.eval8(x, y, dx);
+			wy.eval8(x, y, dy);
+			for (int i = 0; i < 8; i++) {
+				dx[i] = x[i] + dx[i] * strength;
+				dy[i] = y[i] + dy[i] * strength;
+			}
+			src.eval8(dx, dy, out);
+		}
+	};
+
+	static const int MAX_CURVE_POINTS = 8;
+
+	// piecewise linear remap through up to 8 (input, output) points sorted by input
+	struct CurveTable {
+		std::array<glm::vec2, MAX_CURVE_POINTS> points{};
+		int count = 0;
+
+		CurveTable() {}
+		CurveTable(std::initializer_list<glm::vec2> list) {
+			for (const glm::vec2& p : list) {
+				if (count < MAX_CURVE_POINTS) points[count++] = p;
+			}
+		}
+
+		float apply(float v) const {
+			if (count == 0) return v;
+			if (v <= points[0].x) return points[0].y;
+			for (int i = 1; i < count; i++) {
+				if (v < points[i].x) {
+					float t = (v - points[i - 1].x) / (points[i].x - points[i - 1].x);
+					return points[i - 1].y + t * (points[i].y - points[i - 1].y);
+				}
+			}
+			return points[count - 1].y;
+		}
+	};
+
+	template<class A>
+	struct Curve : Node {
+		A a;
+		CurveTable table;
+
+		Curve(const A& a_, const CurveTable& t) : a(a_), table(t) {}
+
+		float eval(float x, float y) const {
+			return table.apply(a.eval(x, y));
+		}
+
+		void eval8(const float* x, const float* y, float* out) const {
+			a.eval8(x, y, out);
+			for (int i = 0; i < 8; i++) out[i] = table.apply(out[i]);
+		}
+	};
+
+	template<class A, class B, std::enable_if_t<isNode<A> && isNode<B>, int> = 0>
+	Add<A, B> operator+(const A& a, const B& b) {
+		return Add<A, B>(a, b);
+	}
+
+	template<class A, std::enable_if_t<isNode<A>, int> = 0>
+	Add<A, Constant> operator+(const A& a, float b) {
+		return Add<A, Constant>(a, Constant(b));
+	}
+
+	template<class A, class B, std::enable_if_t<isNode<A> && isNode<B>, int> = 0>
+	Mul<A, B> operator*(const A& a, const B& b) {
+		return Mul<A, B>(a, b);
+	}
+
+	template<class A, std::enable_if_t<isNode<A>, int> = 0>
+	Mul<A, Constant> operator*(const A& a, float b) {
+		return Mul<A, Constant>(a, Constant(b));
+	}
+
+	template<class A>
+	Clamp<A> clampNode(const A& a, float lo, float hi) {
+		return Clamp<A>(a, lo, hi);
+	}
+
+	template<class Src, class WX, class WY>
+	Warp<Src, WX, WY> warpNode(const Src& src, const WX& wx, const WY& wy, float strength) {
+		return Warp<Src, WX, WY>(src, wx, wy, strength);
+	}
+
+	template<class A>
+	Curve<A> curveNode(const A& a, const CurveTable& table) {
+		return Curve<A>(a, table);
+	}
+
+	/*
+		Same contract as PerlinNoise::generateRegion: evaluates the recipe at
+		origin + (x, y) * scale for the w x h region at pixel (x0, y0) of a
+		buffer with rows stride floats apart.
+	*/
+	template<class Expr>
+	void generateRegion(const Expr& expr, float* out, int stride, int x0, int y0, int w, int h, glm::vec2 origin, float scale) {
+		float xs[8], ys[8], values[8];
+
+		for (int y = y0; y < y0 + h; y++) {
+			float sy = origin.y + (float)y * scale;
+			float* row = out + (size_t)y * stride;
+			for (int i = 0; i < 8; i++) ys[i] = sy;
+
+			for (int x = x0; x < x0 + w; x += 8) {
+				for (int i = 0; i < 8; i++) xs[i] = origin.x + (float)(x + i) * scale;
+				expr.eval8(xs, ys, values);
+
+				int count = std::min(8, x0 + w - x);
+				for (int i = 0; i < count; i++) row[x + i] = values[i];
+			}
+		}
+	}
+
+	enum NODE_KIND {
+		NODE_CONSTANT,
+		NODE_PERLIN,
+		NODE_FRACTAL,
+		NODE_ADD,
+		NODE_MUL,
+		NODE_CLAMP,
+		NODE_WARP,
+		NODE_CURVE
+	};
+
+	/*
+		Runtime-built graph evaluated by walking its nodes for every sample.
+		Slower than a fused recipe, but the recipe can come from data.
+		Nodes are referenced by the index returned when they are added, and
+		the last node added is the output.
+	*/
+	class NoiseGraph {
+	private:
+		struct GraphNode {
+			NODE_KIND kind;
+			int inputs[3] = { -1, -1, -1 };
+			float params[2] = { 0.0f, 0.0f };
+			const PerlinNoise* perlin = nullptr;
+			const FractalNoise* fractal = nullptr;
+			CurveTable curve;
+
+			explicit GraphNode(NODE_KIND k) : kind(k) {}
+		};
+
+		std::vector<GraphNode> m_nodes;
+
+		int push(const GraphNode& node);
+		float evalNode(int index, float x, float y) const;
+	public:
+		int constant(float value);
+		int perlin(const PerlinNoise& noise, float frequency = 1.0f);
+		int fractal(const FractalNoise& noise, float frequency = 1.0f);
+		int add(int a, int b);
+		int mul(int a, int b);
+		int clamp(int a, float lo, float hi);
+		int warp(int src, int wx, int wy, float strength);
+		int curve(int a, const CurveTable& table);
+
+		size_t size() const;
+		float eval(float x, float y) const;
+		void generateRegion(float* out, int stride, int x0, int y0, int w, int h, glm::vec2 origin, float scale) const;
+	};
+}
@@ -0,0 +1,140 @@
+#include "noise_simd.hpp"
+#include "simd.hpp"
+
+#ifdef TERRAIN_X86
+#include <immintrin.h>
+
+// shared tail of the 4-wide kernels: hashing, gradients, fade and lerps
+TERRAIN_TARGET("sse2")
+static inline __m128 perlin4(const int32_t* perm, __m128i xi, __m128 xf, __m128i yi, __m128 yf) {
+	const __m128i mask = _mm_set1_epi32(255);
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	alignas(16) int32_t X[4], Y[4];
+	_mm_store_si128((__m128i*)X, _mm_and_si128(xi, mask));
+	_mm_store_si128((__m128i*)Y, _mm_and_si128(yi, mask));
+
+	// no gather before AVX2, the table lookups are done one lane at a time
+	alignas(16) float gx00[4], gy00[4], gx10[4], gy10[4], gx01[4], gy01[4], gx11[4], gy11[4];
+	for (int i = 0; i < 4; i++) {
+		int a = perm[X[i]] + Y[i];
+		int b = perm[X[i] + 1] + Y[i];
+		int h00 = perm[a] & 7, h10 = perm[b] & 7, h01 = perm[a + 1] & 7, h11 = perm[b + 1] & 7;
+		gx00[i] = PERLIN_GRAD_X[h00]; gy00[i] = PERLIN_GRAD_Y[h00];
+		gx10[i] = PERLIN_GRAD_X[h10]; gy10[i] = PERLIN_GRAD_Y[h10];
+		gx01[i] = PERLIN_GRAD_X[h01]; gy01[i] = PERLIN_GRAD_Y[h01];
+		gx11[i] = PERLIN_GRAD_X[h11]; gy11[i] = PERLIN_GRAD_Y[h11];
+	}
+
+	__m128 xf1 = _mm_sub_ps(xf, one);
+	__m128 yf1 = _mm_sub_ps(yf, one);
+
+	__m128 g00 = _mm_add_ps(_mm_mul_ps(_mm_load_ps(gx00), xf), _mm_mul_ps(_mm_load_ps(gy00), yf));
+	__m128 g10 = _mm_add_ps(_mm_mul_ps(_mm_load_ps(gx10), xf1), _mm_mul_ps(_mm_load_ps(gy10), yf));
+	__m128 g01 = _mm_add_ps(_mm_mul_ps(_mm_load_ps(gx01), xf), _mm_mul_ps(_mm_load_ps(gy01), yf1));
+	__m128 g11 = _mm_add_ps(_mm_mul_ps(_mm_load_ps(gx11), xf1), _mm_mul_ps(_mm_load_ps(gy11), yf1));
+
+	const __m128 six = _mm_set1_ps(6.0f), fifteen = _mm_set1_ps(15.0f), ten = _mm_set1_ps(10.0f);
+	__m128 u = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(xf, xf), xf),
+		_mm_add_ps(_mm_mul_ps(xf, _mm_sub_ps(_mm_mul_ps(xf, six), fifteen)), ten));
+	__m128 v = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(yf, yf), yf),
+		_mm_add_ps(_mm_mul_ps(yf, _mm_sub_ps(_mm_mul_ps(yf, six), fifteen)), ten));
+
+	__m128 x0 = _mm_add_ps(g00, _mm_mul_ps(u, _mm_sub_ps(g10, g00)));
+	__m128 x1 = _mm_add_ps(g01, _mm_mul_ps(u, _mm_sub_ps(g11, g01)));
+	return _mm_add_ps(x0, _mm_mul_ps(v, _mm_sub_ps(x1, x0)));
+}
+
+// floor without SSE4.1: truncate, then step down where truncation rounded up
+TERRAIN_TARGET("sse2")
+static inline __m128i floor4SSE2(__m128 x) {
+	__m128i i = _mm_cvttps_epi32(x);
+	__m128 roundedUp = _mm_cmplt_ps(x, _mm_cvtepi32_ps(i));
+	return _mm_add_epi32(i, _mm_castps_si128(roundedUp));
+}
+
+TERRAIN_TARGET("sse2")
+void perlinNoise8SSE2(const int32_t* perm, const float* x, const float* y, float* out) {
+	for (int i = 0; i < 8; i += 4) {
+		__m128 px = _mm_loadu_ps(x + i);
+		__m128 py = _mm_loadu_ps(y + i);
+		__m128i xi = floor4SSE2(px);
+		__m128i yi = floor4SSE2(py);
+		__m128 xf = _mm_sub_ps(px, _mm_cvtepi32_ps(xi));
+		__m128 yf = _mm_sub_ps(py, _mm_cvtepi32_ps(yi));
+		_mm_storeu_ps(out + i, perlin4(perm, xi, xf, yi, yf));
+	}
+}
+
+TERRAIN_TARGET("sse4.1")
+void perlinNoise8SSE41(const int32_t* perm, const float* x, const float* y, float* out) {
+	for (int i = 0; i < 8; i += 4) {
+		__m128 px = _mm_loadu_ps(x + i);
+		__m128 py = _mm_loadu_ps(y + i);
+		__m128 fx = _mm_floor_ps(px);
+		__m128 fy = _mm_floor_ps(py);
+		__m128 xf = _mm_sub_ps(px, fx);
+		__m128 yf = _mm_sub_ps(py, fy);
+		_mm_storeu_ps(out + i, perlin4(perm, _mm_cvttps_epi32(fx), xf, _mm_cvttps_epi32(fy), yf));
+	}
+}
+
+TERRAIN_TARGET("avx2")
+void perlinNoise8AVX2(const int32_t* perm, const float* x, const float* y, float* out) {
+	const __m256i mask = _mm256_set1_epi32(255);
+	const __m256i ione = _mm256_set1_epi32(1);
+	const __m256 one = _mm256_set1_ps(1.0f);
+
+	__m256 px = _mm256_loadu_ps(x);
+	__m256 py = _mm256_loadu_ps(y);
+	__m256 fx = _mm256_floor_ps(px);
+	__m256 fy = _mm256_floor_ps(py);
+	__m256 xf = _mm256_sub_ps(px, fx);
+	__m256 yf = _mm256_sub_ps(py, fy);
+
+	__m256i X = _mm256_and_si256(_mm256_cvttps_epi32(fx), mask);
+	__m256i Y = _mm256_and_si256(_mm256_cvttps_epi32(fy), mask);
+
+	__m256i a = _mm256_add_epi32(_mm256_i32gather_epi32((const int*)perm, X, 4), Y);
+	__m256i b = _mm256_add_epi32(_mm256_i32gather_epi32((const int*)perm, _mm256_add_epi32(X, ione), 4), Y);
+
+	// permutevar only looks at the low 3 bits of each index, which is the & 7 of the scalar path
+	__m256i h00 = _mm256_i32gather_epi32((const int*)perm, a, 4);
+	__m256i h10 = _mm256_i32gather_epi32((const int*)perm, b, 4);
+	__m256i h01 = _mm256_i32gather_epi32((const int*)perm, _mm256_add_epi32(a, ione), 4);
+	__m256i h11 = _mm256_i32gather_epi32((const int*)perm, _mm256_add_epi32(b, ione), 4);
+
+	const __m256 gradX = _mm256_loadu_ps(PERLIN_GRAD_X);
+	const __m256 gradY = _mm256_loadu_ps(PERLIN_GRAD_Y);
+
+	__m256 xf1 = _mm256_sub_ps(xf, one);
+	__m256 yf1 = _mm256_sub_ps(yf, one);
+
+	__m256 g00 = _mm256_add_ps(_mm256_mul_ps(_mm256_permutevar8x32_ps(gradX, h00), xf),
+		_mm256_mul_ps(_mm256_permutevar8x32_ps(gradY, h00), yf));
+	__m256 g10 = _mm256_add_ps(_mm256_mul_ps(_mm256_permutevar8x32_ps(gradX, h10), xf1),
+		_mm256_mul_ps(_mm256_permutevar8x32_ps(gradY, h10), yf));
+	__m256 g01 = _mm256_add_ps(_mm256_mul_ps(_mm256_permutevar8x32_ps(gradX, h01), xf),
+		_mm256_mul_ps(_mm256_permutevar8x32_ps(gradY, h01), yf1));
+	__m256 g11 = _mm256_add_ps(_mm256_mul_ps(_mm256_permutevar8x32_ps(gradX, h11), xf1),
+		_mm256_mul_ps(_mm256_permutevar8x32_ps(gradY, h11), yf1));
+
+	const __m256 six = _mm256_set1_ps(6.0f), fifteen = _mm256_set1_ps(15.0f), ten = _mm256_set1_ps(10.0f);
+	__m256 u = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(xf, xf), xf),
+		_mm256_add_ps(_mm256_mul_ps(xf, _mm256_sub_ps(_mm256_mul_ps(xf, six), fifteen)), ten));
+	__m256 v = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(yf, yf), yf),
+		_mm256_add_ps(_mm256_mul_ps(yf, _mm256_sub_ps(_mm256_mul_ps(yf, six), fifteen)), ten));
+
+	__m256 x0 = _mm256_add_ps(g00, _mm256_mul_ps(u, _mm256_sub_ps(g10, g00)));
+	__m256 x1 = _mm256_add_ps(g01, _mm256_mul_ps(u, _mm256_sub_ps(g11, g01)));
+	_mm256_storeu_ps(out, _mm256_add_ps(x0, _mm256_mul_ps(v, _mm256_sub_ps(x1, x0))));
+}
+
+#else
+
+// non-x86 builds only ever dispatch to the scalar path
+void perlinNoise8SSE2(const int32_t*, const float*, const float*, float*) {}
+void perlinNoise8SSE41(const int32_t*, const float*, const float*, float*) {}
+void perlinNoise8AVX2(const int32_t*, const float*, const float*, float*) {}
+
+#endif
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+	Vectorized PerlinNoise kernels, 8 samples per call. Every kernel performs
+	the same float operations in the same order as PerlinNoise::noise (no
+	FMA contraction), so the results are bit-identical to the scalar path.
+
+	perm is PerlinNoise::permutation() (512 entries).
+*/
+
+extern const float PERLIN_GRAD_X[8];
+extern const float PERLIN_GRAD_Y[8];
+
+void perlinNoise8SSE2(const int32_t* perm, const float* x, const float* y, float* out);
+void perlinNoise8SSE41(const int32_t* perm, const float* x, const float* y, float* out);
+void perlinNoise8AVX2(const int32_t* perm, const float* x, const float* y, float* out);
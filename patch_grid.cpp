@@ -0,0 +1,172 @@
+#include "patch_grid.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+void writePatchGrid(float* out, glm::vec2 min, glm::vec2 size, glm::vec2 uvMin, glm::vec2 uvMax, int rez,
+	const glm::vec2* bounds, const PatchRoughness* roughness)
+{
+	glm::vec2 uvSize = uvMax - uvMin;
+
+	auto vertex = [&](int i, int j, glm::vec2 range, const PatchRoughness& patch) {
+		*out++ = min.x + size.x * i / (float)rez; // v.x
+		*out++ = 0.0f;                           // v.y
+		*out++ = min.y + size.y * j / (float)rez; // v.z
+		*out++ = uvMin.x + uvSize.x * i / (float)rez; // u
+		*out++ = uvMin.y + uvSize.y * j / (float)rez; // v
+		*out++ = range.x; // lowest height
+		*out++ = range.y; // highest height
+		*out++ = patch.edges.x;
+		*out++ = patch.edges.y;
+		*out++ = patch.edges.z;
+		*out++ = patch.edges.w;
+		*out++ = patch.interior;
+	};
+
+	for (int i = 0; i < rez; i++) {
+		for (int j = 0; j < rez; j++) {
+			glm::vec2 range = bounds[i * rez + j];
+			const PatchRoughness& patch = roughness[i * rez + j];
+			vertex(i, j, range, patch);
+			vertex(i + 1, j, range, patch);
+			vertex(i, j + 1, range, patch);
+			vertex(i + 1, j + 1, range, patch);
+		}
+	}
+}
+
+void patchHeightBounds(glm::vec2* bounds, glm::vec2 uvMin, glm::vec2 uvMax, int rez, const HeightPyramid& pyramid) {
+	glm::vec2 uvSize = uvMax - uvMin;
+	int width = pyramid.width(), height = pyramid.height();
+
+	// texel centers sit at (k + 0.5) / size, bilinear filtering mixes the two around a coordinate
+	auto texelRange = [](float uv0, float uv1, int size, int& first, int& last) {
+		first = (int)std::floor(uv0 * size - 0.5f);
+		last = (int)std::ceil(uv1 * size - 0.5f);
+	};
+
+	/*
+		Texels [first, last] as spans inside the map, the parts hanging over
+		an edge wrapped to the other side. A span [a, b] of texels is the
+		cells [a, b), which range() widens to a whole cell when a == b.
+	*/
+	auto wrappedSpans = [](int first, int last, int size, glm::ivec2* spans) {
+		int count = 0;
+		spans[count++] = glm::ivec2(std::max(first, 0), std::min(last, size - 1));
+		if (first < 0) {
+			spans[count++] = glm::ivec2(std::max(first + size, 0), size - 1);
+		}
+		if (last > size - 1) {
+			spans[count++] = glm::ivec2(0, std::min(last - size, size - 1));
+		}
+		return count;
+	};
+
+	for (int i = 0; i < rez; i++) {
+		int x0, x1;
+		texelRange(uvMin.x + uvSize.x * i / (float)rez, uvMin.x + uvSize.x * (i + 1) / (float)rez, width, x0, x1);
+		glm::ivec2 spansX[3];
+		int countX = wrappedSpans(x0, x1, width, spansX);
+
+		for (int j = 0; j < rez; j++) {
+			int y0, y1;
+			texelRange(uvMin.y + uvSize.y * j / (float)rez, uvMin.y + uvSize.y * (j + 1) / (float)rez, height, y0, y1);
+			glm::ivec2 spansY[3];
+			int countY = wrappedSpans(y0, y1, height, spansY);
+
+			float lo = 1.0f, hi = 0.0f;
+			for (int sy = 0; sy < countY; sy++) {
+				for (int sx = 0; sx < countX; sx++) {
+					glm::vec2 range = pyramid.range(spansX[sx].x, spansY[sy].x, spansX[sx].y, spansY[sy].y);
+					lo = std::min(lo, range.x);
+					hi = std::max(hi, range.y);
+				}
+			}
+			bounds[i * rez + j] = glm::vec2(worldHeight(lo), worldHeight(hi));
+		}
+	}
+}
+
+void patchRoughness(PatchRoughness* roughness, glm::vec2 uvMin, glm::vec2 uvMax, int rez, int width, int height,
+	const std::function<float(int, int)>& sample)
+{
+	glm::vec2 uvSize = uvMax - uvMin;
+
+	// world height at a texel space position, filtered like GL_LINEAR with GL_REPEAT
+	auto filtered = [&](float x, float y) {
+		float fx = std::floor(x), fy = std::floor(y);
+		int x0 = (int)fx, y0 = (int)fy;
+		int x1 = ((x0 + 1) % width + width) % width, y1 = ((y0 + 1) % height + height) % height;
+		x0 = (x0 % width + width) % width;
+		y0 = (y0 % height + height) % height;
+		float tx = x - fx, ty = y - fy;
+		float top = sample(x0, y0) * (1.0f - tx) + sample(x1, y0) * tx;
+		float bottom = sample(x0, y1) * (1.0f - tx) + sample(x1, y1) * tx;
+		return worldHeight(top * (1.0f - ty) + bottom * ty);
+	};
+
+	// largest deviation from the straight line between two texel space points, one sample per texel
+	auto edge = [&](glm::vec2 a, glm::vec2 b) {
+		int steps = std::max(1, (int)std::ceil(glm::length(b - a)));
+		float ha = filtered(a.x, a.y), hb = filtered(b.x, b.y);
+		float deviation = 0.0f;
+		for (int k = 1; k < steps; k++) {
+			float t = (float)k / (float)steps;
+			glm::vec2 p = a + (b - a) * t;
+			deviation = std::max(deviation, std::fabs(filtered(p.x, p.y) - (ha + (hb - ha) * t)));
+		}
+		return deviation;
+	};
+
+	// patch corner in texel space, where texel centers sit at whole numbers
+	auto corner = [&](int i, int j) {
+		glm::vec2 uv = uvMin + uvSize * glm::vec2((float)i, (float)j) / (float)rez;
+		glm::vec2 p = uv * glm::vec2((float)width, (float)height) - 0.5f;
+		// corners meant to sit on a texel center, like the chunk borders, read exactly that texel
+		glm::vec2 nearest = glm::round(p);
+		return glm::mix(p, nearest, glm::lessThan(glm::abs(p - nearest), glm::vec2(1e-3f)));
+	};
+
+	for (int i = 0; i < rez; i++) {
+		for (int j = 0; j < rez; j++) {
+			glm::vec2 c00 = corner(i, j), c10 = corner(i + 1, j);
+			glm::vec2 c01 = corner(i, j + 1), c11 = corner(i + 1, j + 1);
+
+			PatchRoughness& patch = roughness[i * rez + j];
+			patch.edges = glm::vec4(edge(c00, c01), edge(c00, c10), edge(c10, c11), edge(c01, c11));
+
+			float h00 = filtered(c00.x, c00.y), h10 = filtered(c10.x, c10.y);
+			float h01 = filtered(c01.x, c01.y), h11 = filtered(c11.x, c11.y);
+			int stepsX = std::max(1, (int)std::ceil(c10.x - c00.x));
+			int stepsY = std::max(1, (int)std::ceil(c01.y - c00.y));
+
+			float deviation = 0.0f;
+			for (int y = 1; y < stepsY; y++) {
+				float v = (float)y / (float)stepsY;
+				for (int x = 1; x < stepsX; x++) {
+					float u = (float)x / (float)stepsX;
+					glm::vec2 p = c00 + (c11 - c00) * glm::vec2(u, v);
+					float flat = (h00 * (1.0f - u) + h10 * u) * (1.0f - v) + (h01 * (1.0f - u) + h11 * u) * v;
+					deviation = std::max(deviation, std::fabs(filtered(p.x, p.y) - flat));
+				}
+			}
+			patch.interior = deviation;
+		}
+	}
+}
+
+void setPatchVertexLayout() {
+	GLsizei stride = PATCH_VERTEX_FLOATS * sizeof(float);
+
+	// position attribute
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(5 * sizeof(float)));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, stride, (void*)(7 * sizeof(float)));
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, stride, (void*)(11 * sizeof(float)));
+	glEnableVertexAttribArray(4);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <functional>
+
+#include "heightmap.hpp"
+#include "height_pyramid.hpp"
+
+// position xyz, uv, world min/max height, edge roughness, interior roughness of the patch
+static const int PATCH_VERTEX_FLOATS = 12;
+
+/*
+	How far the heightmap strays from the flat patch the tessellator starts
+	from, in world units: the largest deviation of each edge from the line
+	between its corners (in the order of gl_TessLevelOuter, u = 0, v = 0,
+	u = 1, v = 1) and of the inside from the bilinear surface through the
+	four corners. Neighbouring patches compute the same value for a shared
+	edge, so the levels derived from it never crack.
+*/
+struct PatchRoughness {
+	glm::vec4 edges = glm::vec4(0.0f);
+	float interior = 0.0f;
+};
+
+// floats written by writePatchGrid() for a rez x rez grid
+inline size_t patchGridFloats(int rez) {
+	return (size_t)rez * rez * 4 * PATCH_VERTEX_FLOATS;
+}
+
+/*
+	Writes the 4 vertex patches of a rez x rez grid covering
+	[min, min + size] on the xz plane, with texture coordinates running
+	from uvMin to uvMax. bounds[i * rez + j] is the world height range of
+	patch (i, j) as returned by patchHeightBounds(), the tessellation
+	control shader culls patches with it. roughness[i * rez + j] from
+	patchRoughness() scales its tessellation levels.
+*/
+void writePatchGrid(float* out, glm::vec2 min, glm::vec2 size, glm::vec2 uvMin, glm::vec2 uvMax, int rez,
+	const glm::vec2* bounds, const PatchRoughness* roughness);
+
+/*
+	World height range of every patch of the same grid, read from the
+	min/max pyramid of its heightmap instead of the texels. Covers every
+	texel that bilinear filtering can mix into the patch, wrapping around
+	the edges like GL_REPEAT, so the range is never too tight, though the
+	pyramid can make it a little looser than the exact one.
+*/
+void patchHeightBounds(glm::vec2* bounds, glm::vec2 uvMin, glm::vec2 uvMax, int rez, const HeightPyramid& pyramid);
+
+/*
+	Roughness of every patch of the same grid, sampled once per texel with
+	the bilinear filtering the evaluation shader uses.
+*/
+void patchRoughness(PatchRoughness* roughness, glm::vec2 uvMin, glm::vec2 uvMax, int rez, int width, int height,
+	const std::function<float(int, int)>& sample);
+
+// attribute layout of the vertices above for the bound VAO and GL_ARRAY_BUFFER
+void setPatchVertexLayout();
@@ -0,0 +1,261 @@
+#include "profiler.hpp"
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+// small stable ids for the trace, in the order threads first record something
+static int threadIndex() {
+	static std::atomic<int> next{ 0 };
+	thread_local int index = next.fetch_add(1);
+	return index;
+}
+
+static int histogramBucket(double us) {
+	int bucket = 0;
+	while (bucket < PROFILE_HISTOGRAM_BUCKETS - 1 && us >= (double)(1ull << bucket)) {
+		bucket++;
+	}
+	return bucket;
+}
+
+// p in [0, 1] of sorted values
+static double percentile(const std::vector<float>& sorted, double p) {
+	if (sorted.empty()) {
+		return 0.0;
+	}
+	size_t index = (size_t)std::min((double)sorted.size() - 1.0, std::floor(p * (double)sorted.size()));
+	return sorted[index];
+}
+
+// names go into JSON as is, quotes and backslashes would break it
+static std::string jsonEscape(const std::string& text) {
+	std::string out;
+	for (char c : text) {
+		if (c == '"' || c == '\\') {
+			out += '\\';
+		}
+		out += c;
+	}
+	return out;
+}
+
+Profiler::Profiler() : m_epoch(Clock::now()) {
+	m_frameZone = zone("frame", PROFILE_CPU);
+}
+
+Profiler& Profiler::instance() {
+	static Profiler profiler;
+	return profiler;
+}
+
+void Profiler::setEnabled(bool enabled) {
+	m_enabled.store(enabled, std::memory_order_relaxed);
+	m_frameStartNs = -1;
+}
+
+int Profiler::zone(const char* name, PROFILE_KIND kind) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (size_t i = 0; i < m_zones.size(); i++) {
+		if (m_zones[i].kind == kind && m_zones[i].name == name) {
+			return (int)i;
+		}
+	}
+	Zone zone;
+	zone.name = name;
+	zone.kind = kind;
+	zone.recentUs.reserve(PROFILE_ROLLING_SAMPLES);
+	m_zones.push_back(std::move(zone));
+	return (int)m_zones.size() - 1;
+}
+
+int64_t Profiler::now() const {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_epoch).count();
+}
+
+void Profiler::addSample(int zoneIndex, int thread, int64_t startNs, int64_t durationNs) {
+	double us = (double)durationNs / 1000.0;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Zone& zone = m_zones[zoneIndex];
+	if (zone.recentUs.size() < PROFILE_ROLLING_SAMPLES) {
+		zone.recentUs.push_back((float)us);
+	}
+	else {
+		zone.recentUs[zone.count % PROFILE_ROLLING_SAMPLES] = (float)us;
+	}
+	zone.count++;
+	zone.totalUs += us;
+	zone.maxUs = std::max(zone.maxUs, us);
+
+	if (m_events.size() < PROFILE_MAX_EVENTS) {
+		m_events.push_back({ zoneIndex, thread, startNs, durationNs });
+	}
+	else {
+		m_droppedEvents++;
+	}
+}
+
+void Profiler::addCpu(int zone, int64_t startNs, int64_t durationNs) {
+	addSample(zone, threadIndex(), startNs, durationNs);
+}
+
+bool Profiler::beginGpu(int zone) {
+	if (m_gpuActive) {
+		return false;
+	}
+
+	unsigned int query;
+	if (m_freeQueries.empty()) {
+		glGenQueries(1, &query);
+	}
+	else {
+		query = m_freeQueries.back();
+		m_freeQueries.pop_back();
+	}
+
+	glBeginQuery(GL_TIME_ELAPSED, query);
+	m_queries[m_frame & 1].push_back({ zone, query, now() });
+	m_gpuActive = true;
+	return true;
+}
+
+void Profiler::endGpu() {
+	glEndQuery(GL_TIME_ELAPSED);
+	m_gpuActive = false;
+}
+
+void Profiler::beginFrame() {
+	if (enabled()) {
+		int64_t start = now();
+		if (m_frameStartNs >= 0) {
+			addCpu(m_frameZone, m_frameStartNs, start - m_frameStartNs);
+		}
+		m_frameStartNs = start;
+	}
+
+	// the set this frame reuses was issued two frames ago
+	m_frame++;
+	std::vector<GpuQuery>& finished = m_queries[m_frame & 1];
+	for (const GpuQuery& query : finished) {
+		GLuint available = GL_FALSE;
+		glGetQueryObjectuiv(query.query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available) {
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(query.query, GL_QUERY_RESULT, &elapsed);
+			addSample(query.zone, -1, query.submittedNs, (int64_t)elapsed);
+		}
+		else {
+			m_droppedQueries++;
+		}
+		m_freeQueries.push_back(query.query);
+	}
+	finished.clear();
+}
+
+void Profiler::releaseGpu() {
+	for (std::vector<GpuQuery>& queries : m_queries) {
+		for (const GpuQuery& query : queries) {
+			m_freeQueries.push_back(query.query);
+		}
+		queries.clear();
+	}
+	if (!m_freeQueries.empty()) {
+		glDeleteQueries((GLsizei)m_freeQueries.size(), m_freeQueries.data());
+		m_freeQueries.clear();
+	}
+}
+
+bool Profiler::writeCsv(std::ostream& out) const {
+	out << "zone,kind,count,mean_us,p50_us,p95_us,p99_us,max_us";
+	out << ",below_1us";
+	for (int bucket = 1; bucket < PROFILE_HISTOGRAM_BUCKETS - 1; bucket++) {
+		out << ",below_" << (1ull << bucket) << "us";
+	}
+	out << ",rest\n";
+
+	for (const Zone& zone : m_zones) {
+		if (zone.count == 0) {
+			continue;
+		}
+
+		std::vector<float> sorted = zone.recentUs;
+		std::sort(sorted.begin(), sorted.end());
+		uint64_t histogram[PROFILE_HISTOGRAM_BUCKETS] = {};
+		for (float us : sorted) {
+			histogram[histogramBucket(us)]++;
+		}
+
+		out << '"' << zone.name << "\"," << (zone.kind == PROFILE_CPU ? "cpu" : "gpu") << ',' << zone.count
+			<< ',' << zone.totalUs / (double)zone.count
+			<< ',' << percentile(sorted, 0.5) << ',' << percentile(sorted, 0.95) << ',' << percentile(sorted, 0.99)
+			<< ',' << zone.maxUs;
+		for (uint64_t count : histogram) {
+			out << ',' << count;
+		}
+		out << '\n';
+	}
+	return (bool)out;
+}
+
+bool Profiler::writeTrace(std::ostream& out) const {
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":-1,\"args\":{\"name\":\"GPU\"}}";
+	out.precision(3);
+	out << std::fixed;
+	for (const Event& event : m_events) {
+		const Zone& zone = m_zones[event.zone];
+		out << ",\n{\"ph\":\"X\",\"name\":\"" << jsonEscape(zone.name) << "\",\"cat\":\""
+			<< (zone.kind == PROFILE_CPU ? "cpu" : "gpu") << "\",\"pid\":1,\"tid\":" << event.thread
+			<< ",\"ts\":" << (double)event.startNs / 1000.0 << ",\"dur\":" << (double)event.durationNs / 1000.0 << '}';
+	}
+	out << "\n]}\n";
+	return (bool)out;
+}
+
+bool Profiler::write(const std::string& path) const {
+	std::ofstream file(path, std::ios::trunc);
+	if (!file) {
+		std::cout << "COULD NOT WRITE THE PROFILE: " << path << std::endl;
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	bool csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+	if (!(csv ? writeCsv(file) : writeTrace(file))) {
+		std::cout << "COULD NOT WRITE THE PROFILE: " << path << std::endl;
+		return false;
+	}
+	if (!csv && m_droppedEvents > 0) {
+		std::cout << "Profile trace is missing the last " << m_droppedEvents << " events\n";
+	}
+	return true;
+}
+
+void Profiler::printSummary() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::cout << "Profile (last " << PROFILE_ROLLING_SAMPLES << " samples per zone):\n";
+	for (const Zone& zone : m_zones) {
+		if (zone.count == 0) {
+			continue;
+		}
+		std::vector<float> sorted = zone.recentUs;
+		std::sort(sorted.begin(), sorted.end());
+		double mean = 0.0;
+		for (float us : sorted) {
+			mean += us;
+		}
+		mean /= (double)sorted.size();
+
+		std::cout << "  " << zone.name << (zone.kind == PROFILE_CPU ? " (cpu)" : " (gpu)")
+			<< "  mean: " << mean / 1000.0 << " ms"
+			<< "  p95: " << percentile(sorted, 0.95) / 1000.0 << " ms"
+			<< "  max: " << zone.maxUs / 1000.0 << " ms"
+			<< "  count: " << zone.count << '\n';
+	}
+	if (m_droppedQueries > 0) {
+		std::cout << "  " << m_droppedQueries << " GPU timings were not ready two frames later and were dropped\n";
+	}
+}
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+	Frame profiler.
+
+	PROFILE_SCOPE("name") times the rest of the enclosing block on the CPU,
+	on any thread. PROFILE_GPU_SCOPE("name") also wraps the GL commands the
+	block issues in a GL_TIME_ELAPSED query, so a pass shows up twice: the
+	CPU time spent submitting it and the GPU time spent running it. GPU
+	scopes must not nest, GL has one time query active at a time.
+
+	The queries are double buffered by frame: PROFILE_FRAME() at the start
+	of a frame reads the ones issued two frames before, which the GPU has
+	finished by then, and never waits for a result. A query still pending
+	is dropped instead.
+
+	Every zone keeps its count, mean and max over the whole run plus its
+	last PROFILE_ROLLING_SAMPLES durations, from which write() derives the
+	percentiles and a log2 histogram. Each timing is also kept as an event
+	for a Chrome trace, up to PROFILE_MAX_EVENTS.
+
+	Without TERRAIN_PROFILE defined the macros expand to nothing. With it,
+	a scope costs one relaxed load while the profiler is disabled.
+*/
+
+static const int PROFILE_ROLLING_SAMPLES = 1024;
+static const size_t PROFILE_MAX_EVENTS = 1u << 20;
+
+// log2 microsecond buckets: below 1 us, below 2 us, ... below 2^(n - 2) us, and the rest
+static const int PROFILE_HISTOGRAM_BUCKETS = 24;
+
+enum PROFILE_KIND {
+	PROFILE_CPU,
+	PROFILE_GPU
+};
+
+class Profiler {
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct Zone {
+		std::string name;
+		PROFILE_KIND kind;
+		uint64_t count = 0;
+		double totalUs = 0.0;
+		double maxUs = 0.0;
+		std::vector<float> recentUs; // ring of the last PROFILE_ROLLING_SAMPLES
+	};
+
+	struct Event {
+		int zone;
+		int thread;       // -1 for the GPU
+		int64_t startNs;  // since the profiler was created; GPU events start when they were submitted
+		int64_t durationNs;
+	};
+
+	struct GpuQuery {
+		int zone;
+		unsigned int query;
+		int64_t submittedNs;
+	};
+
+	Clock::time_point m_epoch;
+	std::atomic<bool> m_enabled{ false };
+
+	mutable std::mutex m_mutex;
+	std::vector<Zone> m_zones;
+	std::vector<Event> m_events;
+	size_t m_droppedEvents = 0;
+
+	// render thread only
+	std::vector<GpuQuery> m_queries[2];
+	std::vector<unsigned int> m_freeQueries;
+	unsigned m_frame = 0;
+	int64_t m_frameStartNs = -1;
+	int m_frameZone;
+	bool m_gpuActive = false;
+	size_t m_droppedQueries = 0;
+
+	Profiler();
+
+	void addSample(int zone, int thread, int64_t startNs, int64_t durationNs);
+	bool writeCsv(std::ostream& out) const;
+	bool writeTrace(std::ostream& out) const;
+public:
+	static Profiler& instance();
+
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	void setEnabled(bool enabled);
+	bool enabled() const {
+		return m_enabled.load(std::memory_order_relaxed);
+	}
+
+	// index of the zone with this name and kind, registered on first use
+	int zone(const char* name, PROFILE_KIND kind);
+
+	// nanoseconds since the profiler was created
+	int64_t now() const;
+
+	// a CPU timing, from any thread
+	void addCpu(int zone, int64_t startNs, int64_t durationNs);
+
+	// render thread, with the context current. Returns false when no query was started
+	bool beginGpu(int zone);
+	void endGpu();
+
+	// render thread: closes the frame zone and collects the queries of two frames ago
+	void beginFrame();
+
+	// deletes the query objects, before the context goes
+	void releaseGpu();
+
+	// a .csv gets the per-zone statistics and histograms, anything else a Chrome trace (chrome://tracing, Perfetto)
+	bool write(const std::string& path) const;
+
+	// mean, 95th percentile and max of every zone over the rolling window
+	void printSummary() const;
+};
+
+class ProfileScope {
+private:
+	int m_zone;
+	int64_t m_start = -1;
+public:
+	explicit ProfileScope(int zone) : m_zone(zone) {
+		Profiler& profiler = Profiler::instance();
+		if (profiler.enabled()) {
+			m_start = profiler.now();
+		}
+	}
+
+	~ProfileScope() {
+		if (m_start >= 0) {
+			Profiler& profiler = Profiler::instance();
+			profiler.addCpu(m_zone, m_start, profiler.now() - m_start);
+		}
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+class GpuProfileScope {
+private:
+	ProfileScope m_cpu;
+	bool m_active;
+public:
+	GpuProfileScope(int cpuZone, int gpuZone) : m_cpu(cpuZone) {
+		Profiler& profiler = Profiler::instance();
+		m_active = profiler.enabled() && profiler.beginGpu(gpuZone);
+	}
+
+	~GpuProfileScope() {
+		if (m_active) {
+			Profiler::instance().endGpu();
+		}
+	}
+
+	GpuProfileScope(const GpuProfileScope&) = delete;
+	GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+};
+
+#ifdef TERRAIN_PROFILE
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#define PROFILE_SCOPE(name) \
+	static const int PROFILE_CONCAT(profileZone, __LINE__) = Profiler::instance().zone(name, PROFILE_CPU); \
+	ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(PROFILE_CONCAT(profileZone, __LINE__))
+
+#define PROFILE_GPU_SCOPE(name) \
+	static const int PROFILE_CONCAT(profileCpuZone, __LINE__) = Profiler::instance().zone(name, PROFILE_CPU); \
+	static const int PROFILE_CONCAT(profileGpuZone, __LINE__) = Profiler::instance().zone(name, PROFILE_GPU); \
+	GpuProfileScope PROFILE_CONCAT(profileScope, __LINE__)(PROFILE_CONCAT(profileCpuZone, __LINE__), \
+		PROFILE_CONCAT(profileGpuZone, __LINE__))
+
+#define PROFILE_FRAME() Profiler::instance().beginFrame()
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_GPU_SCOPE(name)
+#define PROFILE_FRAME()
+#endif
@@ -1,14 +1,33 @@
 #include "shader.hpp"
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <sstream>
 #include <fstream>
 #include <iostream>
+#include <vector>
+
+// linked programs are cached here, one file per combination of sources and driver
+static const char* SHADER_CACHE_DIR = "./shader_cache";
+static const char PROGRAM_BINARY_MAGIC[4] = { 'S', 'H', 'B', 'N' };
+
+static const GLenum STAGE_TYPES[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_TESS_CONTROL_SHADER, GL_TESS_EVALUATION_SHADER };
+static const char* STAGE_NAMES[] = { "VERTEX", "PIXEL", "TESSELLATION CONTROL", "TESSELLATION EVALUATION" };
+
+bool Shader::s_parallelCompile = false;
+
+struct ProgramBinaryHeader {
+	char magic[4];
+	GLenum format;   // as returned by glGetProgramBinary
+	uint32_t length; // bytes of binary following the header
+};
 
 Shader::Shader(const std::string& vertexShaderPath, const std::string& pixelShaderPath,
 	const std::string& tscShaderPath, const std::string& tseShaderPath)
 	: m_program(0)
 {
-	std::string vertexCode, pixelCode, tscCode, tseCode;
 	std::ifstream vertexFile, pixelFile, tscFile, tseFile;
 
 	vertexFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
@@ -33,60 +52,206 @@ Shader::Shader(const std::string& vertexShaderPath, const std::string& pixelShad
 		tscFile.close();
 		tseFile.close();
 
-		vertexCode = vertexStream.str();
-		pixelCode = pixelStream.str();
-		tscCode = tscStream.str();
-		tseCode = tseStream.str();
+		m_sources[0] = vertexStream.str();
+		m_sources[1] = pixelStream.str();
+		m_sources[2] = tscStream.str();
+		m_sources[3] = tseStream.str();
 	}
 	catch (std::ifstream::failure& e) {
 		std::cout << "SHADER FILES NO SUCCESSFULLY READ: " << e.what() << std::endl;
 	}
 
-	const char* vertexCodeRaw = vertexCode.c_str();
-	const char* pixelCodeRaw = pixelCode.c_str();
-	const char* tscCodeRaw = tscCode.c_str();
-	const char* tseCodeRaw = tseCode.c_str();
+	m_cachePath = binaryCachePath({ &m_sources[0], &m_sources[1], &m_sources[2], &m_sources[3] });
+	if (m_cachePath.empty() || !submitBinary(m_cachePath)) {
+		submitCompile();
+	}
+};
 
-	unsigned int vertex, pixel, tessCtrl, tessEv;
-	vertex = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertex, 1, &vertexCodeRaw, NULL);
-	glCompileShader(vertex);
+bool Shader::enableParallelCompile() {
+	// let the driver pick the number of compiler threads
+	if (GLAD_GL_KHR_parallel_shader_compile) {
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+		s_parallelCompile = true;
+	}
+	else if (GLAD_GL_ARB_parallel_shader_compile) {
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFFu);
+		s_parallelCompile = true;
+	}
+	return s_parallelCompile;
+}
 
-	checkShaderCompileErrors(vertex, "VERTEX");
+void Shader::submitCompile() {
+	m_program = glCreateProgram();
 
-	pixel = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(pixel, 1, &pixelCodeRaw, NULL);
-	glCompileShader(pixel);
+	// no status queries until the link is done, any of them would wait for the compiler
+	for (int i = 0; i < STAGE_COUNT; i++) {
+		const char* code = m_sources[i].c_str();
+		m_stages[i] = glCreateShader(STAGE_TYPES[i]);
+		glShaderSource(m_stages[i], 1, &code, NULL);
+		glCompileShader(m_stages[i]);
+		glAttachShader(m_program, m_stages[i]);
+	}
 
-	checkShaderCompileErrors(pixel, "PIXEL");
+	// lets saveBinary() read the linked program back
+	glProgramParameteri(m_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(m_program);
+	m_state = SHADER_COMPILING;
+}
 
-	tessCtrl = glCreateShader(GL_TESS_CONTROL_SHADER);
-	glShaderSource(tessCtrl, 1, &tscCodeRaw, NULL);
-	glCompileShader(tessCtrl);
+void Shader::finish() {
+	if (m_state == SHADER_LOADING_BINARY) {
+		// drivers reject binaries from other versions at this point, that is not an error
+		int success;
+		glGetProgramiv(m_program, GL_LINK_STATUS, &success);
+		if (!success) {
+			std::cout << "PROGRAM BINARY REJECTED, RECOMPILING: " << m_cachePath << std::endl;
+			glDeleteProgram(m_program);
+			submitCompile();
+			return;
+		}
+		m_fromCache = true;
+		m_state = SHADER_READY;
+	}
+	else if (m_state == SHADER_COMPILING) {
+		for (int i = 0; i < STAGE_COUNT; i++) {
+			checkShaderCompileErrors(m_stages[i], STAGE_NAMES[i]);
+		}
+		bool linked = checkProgramLinkErrors(m_program);
+
+		for (int i = 0; i < STAGE_COUNT; i++) {
+			glDeleteShader(m_stages[i]);
+			m_stages[i] = 0;
+		}
+		if (linked && !m_cachePath.empty()) {
+			saveBinary(m_cachePath);
+		}
+		m_state = linked ? SHADER_READY : SHADER_FAILED;
+	}
+	else {
+		return;
+	}
 
-	checkShaderCompileErrors(tessCtrl, "TESSELLATION CONTROL");
+	cacheUniformLocations();
+	for (std::string& source : m_sources) {
+		source = std::string();
+	}
+}
 
-	tessEv = glCreateShader(GL_TESS_EVALUATION_SHADER);
-	glShaderSource(tessEv, 1, &tseCodeRaw, NULL);
-	glCompileShader(tessEv);
+bool Shader::ready() {
+	if (m_state == SHADER_READY || m_state == SHADER_FAILED) {
+		return true;
+	}
 
-	checkShaderCompileErrors(tessEv, "TESSELLATION EVALUATION");
+	if (s_parallelCompile) {
+		int done = 0;
+		glGetProgramiv(m_program, GL_COMPLETION_STATUS_KHR, &done);
+		if (!done) {
+			return false;
+		}
+	}
 
-	m_program = glCreateProgram();
+	// without the extension this is where the compile is waited for
+	finish();
+	return m_state == SHADER_READY || m_state == SHADER_FAILED;
+}
 
-	glAttachShader(m_program, vertex);
-	glAttachShader(m_program, pixel);
-	glAttachShader(m_program, tessCtrl);
-	glAttachShader(m_program, tessEv);
-	glLinkProgram(m_program);
+void Shader::wait() {
+	while (m_state == SHADER_LOADING_BINARY || m_state == SHADER_COMPILING) {
+		finish();
+	}
+}
 
-	checkProgramLinkErrors(m_program);
+bool Shader::valid() const {
+	return m_state == SHADER_READY;
+}
 
-	glDeleteShader(vertex);
-	glDeleteShader(pixel);
-	glDeleteShader(tessCtrl);
-	glDeleteShader(tessEv);
-};
+// 64 bit FNV-1a, only used to tell cache entries apart
+static uint64_t fnv1a(uint64_t hash, const void* data, size_t size) {
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001B3ull;
+	}
+	return hash;
+}
+
+std::string Shader::binaryCachePath(std::initializer_list<const std::string*> sources) {
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	if (formats == 0) {
+		return "";
+	}
+
+	uint64_t hash = 0xCBF29CE484222325ull;
+	for (const std::string* source : sources) {
+		// the terminator keeps moving text from one stage to the next from giving the same hash
+		hash = fnv1a(hash, source->c_str(), source->size() + 1);
+	}
+
+	// a binary is only valid for the driver that produced it
+	for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+		const char* value = (const char*)glGetString(name);
+		if (value) {
+			hash = fnv1a(hash, value, strlen(value) + 1);
+		}
+	}
+
+	char file[32];
+	snprintf(file, sizeof(file), "%016llx.bin", (unsigned long long)hash);
+	return std::string(SHADER_CACHE_DIR) + "/" + file;
+}
+
+bool Shader::submitBinary(const std::string& path) {
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file) {
+		return false;
+	}
+
+	size_t size = (size_t)file.tellg();
+	ProgramBinaryHeader header;
+	if (size < sizeof(header)) {
+		return false;
+	}
+	file.seekg(0);
+	file.read((char*)&header, sizeof(header));
+	if (memcmp(header.magic, PROGRAM_BINARY_MAGIC, 4) != 0 || header.length != size - sizeof(header)) {
+		return false;
+	}
+
+	std::vector<char> binary(header.length);
+	if (!file.read(binary.data(), (std::streamsize)binary.size())) {
+		return false;
+	}
+
+	m_program = glCreateProgram();
+	glProgramBinary(m_program, header.format, binary.data(), (GLsizei)binary.size());
+	m_state = SHADER_LOADING_BINARY;
+	return true;
+}
+
+void Shader::saveBinary(const std::string& path) {
+	int length = 0;
+	glGetProgramiv(m_program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) {
+		return;
+	}
+
+	ProgramBinaryHeader header;
+	memcpy(header.magic, PROGRAM_BINARY_MAGIC, 4);
+	std::vector<char> binary(length);
+	GLsizei written = 0;
+	glGetProgramBinary(m_program, length, &written, &header.format, binary.data());
+	header.length = (uint32_t)written;
+
+	std::error_code error;
+	std::filesystem::create_directories(SHADER_CACHE_DIR, error);
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write((const char*)&header, sizeof(header));
+	file.write(binary.data(), written);
+	if (!file) {
+		std::cout << "COULD NOT WRITE THE PROGRAM BINARY CACHE: " << path << std::endl;
+	}
+}
 
 void Shader::checkShaderCompileErrors(unsigned int target, const char* type) {
 	int success;
@@ -98,53 +263,98 @@ void Shader::checkShaderCompileErrors(unsigned int target, const char* type) {
 	}
 }
 
-void Shader::checkProgramLinkErrors(unsigned int target) {
+bool Shader::checkProgramLinkErrors(unsigned int target) {
 	int success;
 	char log[512];
-	glGetProgramiv(target, GL_COMPILE_STATUS, &success);
+	glGetProgramiv(target, GL_LINK_STATUS, &success);
 	if (!success) {
 		glGetProgramInfoLog(target, 512, NULL, log);
 		std::cout << "PROGRAM LINKAGE FAILED: " << log << std::endl;
 	}
+	return success;
+}
+
+void Shader::cacheUniformLocations() {
+	m_locations.clear();
+
+	int count = 0, maxLength = 0;
+	glGetProgramiv(m_program, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(m_program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+	std::string name(std::max(maxLength, 1), '\0');
+	for (int i = 0; i < count; i++) {
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(m_program, (GLuint)i, (GLsizei)name.size(), &length, &size, &type, name.data());
+		std::string uniform = name.substr(0, length);
+
+		// members of uniform blocks have no location
+		int uniformLocation = glGetUniformLocation(m_program, uniform.c_str());
+		if (uniformLocation < 0) {
+			continue;
+		}
+		m_locations[uniform] = uniformLocation;
+
+		// arrays are reported as "name[0]", also reachable as plain "name"
+		if (uniform.ends_with("[0]")) {
+			m_locations[uniform.substr(0, uniform.size() - 3)] = uniformLocation;
+		}
+	}
+}
+
+int Shader::location(const std::string& name) const {
+	auto it = m_locations.find(name);
+	return it == m_locations.end() ? -1 : it->second;
 }
 
 void Shader::use() {
+	wait();
 	glUseProgram(m_program);
 };
 
 Shader::~Shader() {
+	for (unsigned int stage : m_stages) {
+		if (stage) {
+			glDeleteShader(stage);
+		}
+	}
 	glDeleteProgram(m_program);
 	m_program = 0;
 };
 
 void Shader::setVec2(const std::string& name, const glm::vec2& value) const {
-	glUniform2fv(glGetUniformLocation(m_program, name.c_str()), 1, &value[0]);
+	glUniform2fv(location(name), 1, &value[0]);
 };
 
 void Shader::setVec3(const std::string& name, const glm::vec3& value) const {
-	glUniform3fv(glGetUniformLocation(m_program, name.c_str()), 1, &value[0]);
+	glUniform3fv(location(name), 1, &value[0]);
 };
 
 void Shader::setVec3(const std::string& name, float x, float y, float z) const {
-	glUniform3f(glGetUniformLocation(m_program, name.c_str()), x, y, z);
+	glUniform3f(location(name), x, y, z);
 }
 
 void Shader::setVec4(const std::string& name, const glm::vec4& value) const {
-	glUniform4fv(glGetUniformLocation(m_program, name.c_str()), 1, &value[0]);
+	glUniform4fv(location(name), 1, &value[0]);
 };
 
 void Shader::setVec4(const std::string& name, float x, float y, float z, float w) const {
-	glUniform4f(glGetUniformLocation(m_program, name.c_str()), x, y, z, w);
+	glUniform4f(location(name), x, y, z, w);
 }
 
 void Shader::setInt(const std::string& name, int value) const {
-	glUniform1i(glGetUniformLocation(m_program, name.c_str()), value);
+	glUniform1i(location(name), value);
 };
 
 void Shader::setFloat(const std::string& name, float value) const {
-	glUniform1f(glGetUniformLocation(m_program, name.c_str()), value);
+	glUniform1f(location(name), value);
 };
 
 void Shader::setMat4(const std::string& name, const glm::mat4& value) const {
-	glUniformMatrix4fv(glGetUniformLocation(m_program, name.c_str()), 1, GL_FALSE, &value[0][0]);
-};
\ No newline at end of file
+	glUniformMatrix4fv(location(name), 1, GL_FALSE, &value[0][0]);
+};
+
+bool Shader::loadedFromCache() const {
+	return m_fromCache;
+}
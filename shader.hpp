@@ -3,19 +3,75 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
+#include <initializer_list>
 #include <string>
+#include <unordered_map>
 
+enum SHADER_STATE {
+	SHADER_LOADING_BINARY, // glProgramBinary submitted
+	SHADER_COMPILING,      // stages compiled and program linked, not checked yet
+	SHADER_READY,
+	SHADER_FAILED
+};
+
+static const int STAGE_COUNT = 4;
+
+/*
+	Construction only submits the work: the program binary or the compile
+	and link of the four stages. With GL_KHR_parallel_shader_compile the
+	driver compiles in the background and ready() polls
+	GL_COMPLETION_STATUS_KHR, so several programs build at once while
+	frames keep coming. Without it ready() simply blocks the first time.
+*/
 class Shader {
 private:
 	unsigned int m_program = 0;
+	SHADER_STATE m_state = SHADER_COMPILING;
+	unsigned int m_stages[STAGE_COUNT] = {};
+	std::string m_sources[STAGE_COUNT]; // kept until linked, a rejected binary falls back to them
+	std::string m_cachePath;
+	static bool s_parallelCompile;
+	// every active uniform outside a block, resolved once after linking
+	std::unordered_map<std::string, int> m_locations;
+	bool m_fromCache = false;
 	void checkShaderCompileErrors(unsigned int target, const char* type);
-	void checkProgramLinkErrors(unsigned int target);
+	bool checkProgramLinkErrors(unsigned int target);
+	void cacheUniformLocations();
+
+	void submitCompile();
+	// checks the finished compile or binary load, may block when it is still running
+	void finish();
+
+	/*
+		Linked programs are kept on disk with glGetProgramBinary, keyed by a
+		hash of the four stage sources and the GL vendor, renderer and
+		version. An empty path means the driver offers no binary formats.
+	*/
+	static std::string binaryCachePath(std::initializer_list<const std::string*> sources);
+	bool submitBinary(const std::string& path);
+	void saveBinary(const std::string& path);
 public:
 	Shader(const std::string& vertex_shader_path, const std::string& pixel_shader_path,
 		const std::string& tsc_shader_path, const std::string& tse_shader_path
 	);
 	~Shader();
+
+	// turns on GL_KHR_parallel_shader_compile when the driver has it, call once after loading GL
+	static bool enableParallelCompile();
+
+	// true once the program is linked or has failed to, never blocks while the extension is available
+	bool ready();
+	// blocks until ready()
+	void wait();
+	// linked successfully
+	bool valid() const;
+
+	// waits for the program if it is not ready yet
 	void use();
+	// true when the program came out of the binary cache instead of being compiled
+	bool loadedFromCache() const;
+	// -1 for names the program does not use, which the setters ignore just like GL does
+	int location(const std::string& name) const;
 	void setVec2(const std::string& name, const glm::vec2& value) const;
 	void setVec3(const std::string& name, const glm::vec3& value) const;
 	void setVec3(const std::string& name, float x, float y, float z) const;
@@ -2,44 +2,117 @@
 
 layout(vertices=4) out;
 
-uniform mat4 view;
-uniform mat4 model;
+uniform sampler2DArray heightMap;
+uniform int heightLayer;
+
+layout (std140, binding = 0) uniform FrameConstants {
+	mat4 projection;
+	mat4 view;
+	mat4 model;
+	mat4 viewProjection;
+	mat4 modelView;
+	mat4 modelViewProjection;
+	vec4 frustumPlanes[6];
+	vec2 viewportSize;
+	float trianglesPerPixel;
+};
 
 in vec2 TexCoord[];
+in vec2 HeightBounds[];
+in vec4 EdgeRoughness[];
+in float Roughness[];
 out vec2 TextureCoord[];
 
+// true when the box lies entirely outside one of the frustum planes
+bool outsideFrustum(vec3 boxMin, vec3 boxMax) {
+	for (int i = 0; i < 6; i++) {
+		vec4 plane = frustumPlanes[i];
+		// the corner furthest along the plane normal
+		vec3 corner = mix(boxMin, boxMax, greaterThanEqual(plane.xyz, vec3(0.0)));
+		if (dot(plane.xyz, corner) + plane.w < 0.0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+const float MIN_TESSELLATION_LEVEL = 1.0;
+const float MAX_TESSELLATION_LEVEL = 64.0;
+// deviation over edge length at which a patch gets the full target density
+const float FULL_DETAIL_ROUGHNESS = 0.05;
+// share of the target density left to perfectly flat patches
+const float MIN_DETAIL = 0.125;
+
+// patch corner moved up to the terrain, the evaluation stage reads the same texel
+vec3 terrainCorner(int i) {
+	vec3 p = gl_in[i].gl_Position.xyz;
+	p.y += textureLod(heightMap, vec3(TexCoord[i], heightLayer), 0.0).r * 64.0 - 16.0;
+	return p;
+}
+
+/*
+	Level for an edge from its size on screen, the diameter of the sphere
+	around it projected to pixels, so it does not change as the edge turns.
+	An n x n grid over an area of L x L pixels holds 2n^2 triangles, n =
+	L * sqrt(trianglesPerPixel / 2) meets the target density. Flat edges,
+	that tessellation would not change the look of, get a fraction of it.
+	Both patches sharing an edge compute the same level from the same
+	inputs, so they meet without cracks.
+*/
+float edgeLevel(vec3 a, vec3 b, float roughness) {
+	float diameter = distance(a, b);
+	float eyeDistance = max(length((modelView * vec4((a + b) * 0.5, 1.0)).xyz), 1e-3);
+	float pixels = diameter * projection[1][1] * 0.5 * viewportSize.y / eyeDistance;
+
+	float detail = clamp(roughness / (diameter * FULL_DETAIL_ROUGHNESS), MIN_DETAIL, 1.0);
+	float level = pixels * sqrt(trianglesPerPixel * 0.5) * detail;
+	return clamp(level, MIN_TESSELLATION_LEVEL, MAX_TESSELLATION_LEVEL);
+}
+
 void main() {
 	gl_out[gl_InvocationID].gl_Position = gl_in[gl_InvocationID].gl_Position;
 	TextureCoord[gl_InvocationID] = TexCoord[gl_InvocationID];
 
 	if (gl_InvocationID == 0) {
-		const int MIN_TESSELLATION_LEVEL = 4;
-		const int MAX_TESSELLATION_LEVEL = 64;
-		const float MIN_DISTANCE = 20;
-		const float MAX_DISTANCE = 800;
-
-		vec4 eyeSpacePos00 = view * model * gl_in[0].gl_Position;
-		vec4 eyeSpacePos01 = view * model * gl_in[1].gl_Position;
-		vec4 eyeSpacePos10 = view * model * gl_in[2].gl_Position;
-		vec4 eyeSpacePos11 = view * model * gl_in[3].gl_Position;
-
-		const float	distance00 = clamp((abs(eyeSpacePos00.z) - MIN_DISTANCE) / (MAX_DISTANCE - MIN_DISTANCE), 0.0, 1.0);
-		const float	distance01 = clamp((abs(eyeSpacePos01.z) - MIN_DISTANCE) / (MAX_DISTANCE - MIN_DISTANCE), 0.0, 1.0);
-		const float	distance10 = clamp((abs(eyeSpacePos10.z) - MIN_DISTANCE) / (MAX_DISTANCE - MIN_DISTANCE), 0.0, 1.0);
-		const float	distance11 = clamp((abs(eyeSpacePos11.z) - MIN_DISTANCE) / (MAX_DISTANCE - MIN_DISTANCE), 0.0, 1.0);
-
-		float tessLevel0 = mix( MAX_TESSELLATION_LEVEL, MIN_TESSELLATION_LEVEL, min(distance10, distance00) );
-		float tessLevel1 = mix( MAX_TESSELLATION_LEVEL, MIN_TESSELLATION_LEVEL, min(distance00, distance01) );
-		float tessLevel2 = mix( MAX_TESSELLATION_LEVEL, MIN_TESSELLATION_LEVEL, min(distance01, distance11) );
-		float tessLevel3 = mix( MAX_TESSELLATION_LEVEL, MIN_TESSELLATION_LEVEL, min(distance11, distance10) );
-		
+		/*
+			The evaluation stage only moves the flat patch up by the sampled
+			height, so its corners and the patch's min/max height bound it.
+			A zero outer level makes the primitive generator drop the patch.
+		*/
+		vec3 boxMin = min(min(gl_in[0].gl_Position.xyz, gl_in[1].gl_Position.xyz), min(gl_in[2].gl_Position.xyz, gl_in[3].gl_Position.xyz));
+		vec3 boxMax = max(max(gl_in[0].gl_Position.xyz, gl_in[1].gl_Position.xyz), max(gl_in[2].gl_Position.xyz, gl_in[3].gl_Position.xyz));
+		boxMin.y += HeightBounds[0].x;
+		boxMax.y += HeightBounds[0].y;
+		if (outsideFrustum(boxMin, boxMax)) {
+			gl_TessLevelOuter[0] = 0.0;
+			gl_TessLevelOuter[1] = 0.0;
+			gl_TessLevelOuter[2] = 0.0;
+			gl_TessLevelOuter[3] = 0.0;
+			gl_TessLevelInner[0] = 0.0;
+			gl_TessLevelInner[1] = 0.0;
+			return;
+		}
+
+		// corners in the order of gl_in: (0, 0), (1, 0), (0, 1), (1, 1) in (u, v)
+		vec3 c00 = terrainCorner(0);
+		vec3 c10 = terrainCorner(1);
+		vec3 c01 = terrainCorner(2);
+		vec3 c11 = terrainCorner(3);
+
+		vec4 roughness = EdgeRoughness[0];
+		float tessLevel0 = edgeLevel(c00, c01, roughness.x); // u = 0
+		float tessLevel1 = edgeLevel(c00, c10, roughness.y); // v = 0
+		float tessLevel2 = edgeLevel(c10, c11, roughness.z); // u = 1
+		float tessLevel3 = edgeLevel(c01, c11, roughness.w); // v = 1
+
 		gl_TessLevelOuter[0] = tessLevel0;
 		gl_TessLevelOuter[1] = tessLevel1;
 		gl_TessLevelOuter[2] = tessLevel2;
 		gl_TessLevelOuter[3] = tessLevel3;
-		
-		// set inner tessellation level to the max of the two parallel edges
-		gl_TessLevelInner[0] = max(tessLevel1, tessLevel3);
-		gl_TessLevelInner[1] = max(tessLevel0, tessLevel2);
+
+		// the inside follows its own roughness, never coarser than the parallel edges
+		float interior = Roughness[0];
+		gl_TessLevelInner[0] = max(max(tessLevel1, tessLevel3), max(edgeLevel(c00, c10, interior), edgeLevel(c01, c11, interior)));
+		gl_TessLevelInner[1] = max(max(tessLevel0, tessLevel2), max(edgeLevel(c00, c01, interior), edgeLevel(c10, c11, interior)));
 	}
 }
\ No newline at end of file
@@ -2,10 +2,20 @@
 
 layout (quads, fractional_odd_spacing, ccw) in;
 
-uniform sampler2D heightMap;
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// one layer per terrain chunk
+uniform sampler2DArray heightMap;
+uniform int heightLayer;
+layout (std140, binding = 0) uniform FrameConstants {
+	mat4 projection;
+	mat4 view;
+	mat4 model;
+	mat4 viewProjection;
+	mat4 modelView;
+	mat4 modelViewProjection;
+	vec4 frustumPlanes[6];
+	vec2 viewportSize;
+	float trianglesPerPixel;
+};
 
 in vec2 TextureCoord[];
 out float height;
@@ -25,7 +35,7 @@ void main() {
 	vec2 t1 = (t11 - t10) * u + t10;
 	vec2 texCoord = (t1 - t0) * v + t0;
 
-	height = texture(heightMap, texCoord).y * 64.0 - 16.0;
+	height = texture(heightMap, vec3(texCoord, heightLayer)).r * 64.0 - 16.0;
 
 	vec4 p00 = gl_in[0].gl_Position;
 	vec4 p01 = gl_in[1].gl_Position;
@@ -43,5 +53,5 @@ void main() {
 	vec4 p = (p1 - p0) * v + p0 + normal * height;
 
 	// output patch position in clip space;
-	gl_Position = projection * view * model * p;
+	gl_Position = modelViewProjection * p;
 }
\ No newline at end of file
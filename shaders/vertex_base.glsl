@@ -2,10 +2,19 @@
 
 layout (location = 0) in vec3 a_position;
 layout (location = 1) in vec2 a_texCoord;
+layout (location = 2) in vec2 a_heightBounds;
+layout (location = 3) in vec4 a_edgeRoughness;
+layout (location = 4) in float a_roughness;
 
 out vec2 TexCoord;
+out vec2 HeightBounds;
+out vec4 EdgeRoughness;
+out float Roughness;
 
 void main() {
 	gl_Position = vec4(a_position, 1.0);
 	TexCoord = a_texCoord;
+	HeightBounds = a_heightBounds;
+	EdgeRoughness = a_edgeRoughness;
+	Roughness = a_roughness;
 }
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "simd.hpp"
+
+#include <atomic>
+
+#if defined(TERRAIN_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static SIMD_LEVEL queryCpu() {
+#if defined(TERRAIN_X86) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	int maxLeaf = info[0];
+
+	__cpuid(info, 1);
+	bool sse2 = (info[3] & (1 << 26)) != 0;
+	bool sse41 = (info[2] & (1 << 19)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+
+	bool avx2 = false;
+	if (maxLeaf >= 7 && osxsave && avx) {
+		// the OS has to save the YMM registers on context switch as well
+		bool ymmEnabled = (_xgetbv(0) & 0x6) == 0x6;
+		__cpuidex(info, 7, 0);
+		avx2 = ymmEnabled && (info[1] & (1 << 5)) != 0;
+	}
+
+	if (avx2) return SIMD_AVX2;
+	if (sse41) return SIMD_SSE41;
+	if (sse2) return SIMD_SSE2;
+	return SIMD_SCALAR;
+#elif defined(TERRAIN_X86)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+	if (__builtin_cpu_supports("sse4.1")) return SIMD_SSE41;
+	if (__builtin_cpu_supports("sse2")) return SIMD_SSE2;
+	return SIMD_SCALAR;
+#else
+	return SIMD_SCALAR;
+#endif
+}
+
+SIMD_LEVEL detectSimdLevel() {
+	static const SIMD_LEVEL detected = queryCpu();
+	return detected;
+}
+
+static std::atomic<int> activeLevel{ -1 };
+
+SIMD_LEVEL simdLevel() {
+	int level = activeLevel.load(std::memory_order_relaxed);
+	if (level < 0) {
+		level = detectSimdLevel();
+		activeLevel.store(level, std::memory_order_relaxed);
+	}
+	return (SIMD_LEVEL)level;
+}
+
+void setSimdLevel(SIMD_LEVEL level) {
+	if (level > detectSimdLevel()) {
+		level = detectSimdLevel();
+	}
+	activeLevel.store(level, std::memory_order_relaxed);
+}
+
+const char* simdLevelName(SIMD_LEVEL level) {
+	switch (level) {
+	case SIMD_SSE2: return "SSE2";
+	case SIMD_SSE41: return "SSE4.1";
+	case SIMD_AVX2: return "AVX2";
+	default: return "scalar";
+	}
+}
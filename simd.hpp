@@ -0,0 +1,35 @@
+#pragma once
+
+/*
+	Runtime instruction set selection for the CPU kernels. The kernels are
+	compiled with per-function target attributes, so one binary carries the
+	SSE2, SSE4.1 and AVX2 variants and picks one on the machine it runs on.
+*/
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define TERRAIN_X86 1
+#endif
+
+#if defined(TERRAIN_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TERRAIN_TARGET(isa) __attribute__((target(isa)))
+#else
+#define TERRAIN_TARGET(isa)
+#endif
+
+enum SIMD_LEVEL {
+	SIMD_SCALAR,
+	SIMD_SSE2,
+	SIMD_SSE41,
+	SIMD_AVX2
+};
+
+// best level supported by this CPU, detected once
+SIMD_LEVEL detectSimdLevel();
+
+// level the kernels currently dispatch to; defaults to detectSimdLevel()
+SIMD_LEVEL simdLevel();
+
+// forces a lower level (benchmarks, comparisons against the scalar path); clamped to what the CPU supports
+void setSimdLevel(SIMD_LEVEL level);
+
+const char* simdLevelName(SIMD_LEVEL level);
@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "erosion.hpp"
+#include "fractal.hpp"
+#include "heightmap.hpp"
+#include "heightmap_file.hpp"
+#include "image_write.hpp"
+#include "job_system.hpp"
+#include "noise.hpp"
+#include "noise_graph.hpp"
+#include "terrain_gen.hpp"
+
+/*
+	Headless terrain baker: generates a heightmap on every core and writes
+	it out with its normal map. No window or GL context is involved, so it
+	runs on a build server.
+
+	usage: terrain-bake <output prefix> [options]
+	  --seed N           noise seed (1337)
+	  --size N           texels along each side (4097)
+	  --recipe NAME      fbm, ridged, billow or warped (fbm)
+	  --octaves N        fractal octaves (8)
+	  --scale F          noise units per texel (1/256, the scale of the streamed chunks)
+	  --format r16|r32f  sample format of the .hmap (r16)
+	  --tile N           .hmap tile size (256)
+	  --erode N          hydraulic erosion droplets, 0 for none (0)
+	  --thermal N        thermal erosion iterations after it, 0 for none (0)
+	  --threads N        worker threads, 0 for one per hardware thread (0)
+
+	Writes <prefix>.hmap (the heights in the chosen format, tiled),
+	<prefix>_height.png (16 bit grey) and <prefix>_normal.png (see
+	generateNormalMap) and prints the time every stage took.
+*/
+
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsSince(Clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+struct BakeSettings {
+	std::string prefix;
+	uint32_t seed = 1337;
+	int size = 4097;
+	std::string recipe = "fbm";
+	int octaves = 8;
+	float scale = 1.0f / 256.0f;
+	HEIGHT_FORMAT format = HEIGHT_R16;
+	int tileSize = HMAP_DEFAULT_TILE_SIZE;
+	int droplets = 0;
+	int thermalIterations = 0;
+	unsigned threads = 0;
+};
+
+static void printUsage(const char* program) {
+	std::cout << "usage: " << program << " <output prefix> [--seed N] [--size N] [--recipe fbm|ridged|billow|warped]\n"
+		<< "       [--octaves N] [--scale F] [--format r16|r32f] [--tile N] [--erode droplets]\n"
+		<< "       [--thermal iterations] [--threads N]" << std::endl;
+}
+
+// prints the reason and returns false on a bad command line
+static bool parseArguments(int argc, char** argv, BakeSettings& settings) {
+	if (argc < 2 || std::string(argv[1]).starts_with("--")) {
+		printUsage(argv[0]);
+		return false;
+	}
+	settings.prefix = argv[1];
+
+	for (int i = 2; i < argc; i += 2) {
+		std::string option = argv[i];
+		if (i + 1 >= argc) {
+			std::cout << "MISSING VALUE FOR " << option << std::endl;
+			return false;
+		}
+		std::string value = argv[i + 1];
+
+		// std::stoi and friends throw on values that are not numbers at all
+		try {
+			if (option == "--seed") {
+				settings.seed = (uint32_t)std::stoul(value);
+			}
+			else if (option == "--size") {
+				settings.size = std::stoi(value);
+			}
+			else if (option == "--recipe") {
+				settings.recipe = value;
+			}
+			else if (option == "--octaves") {
+				settings.octaves = std::stoi(value);
+			}
+			else if (option == "--scale") {
+				settings.scale = std::stof(value);
+			}
+			else if (option == "--format") {
+				if (value == "r16") {
+					settings.format = HEIGHT_R16;
+				}
+				else if (value == "r32f") {
+					settings.format = HEIGHT_R32F;
+				}
+				else {
+					std::cout << "UNKNOWN FORMAT: " << value << std::endl;
+					return false;
+				}
+			}
+			else if (option == "--tile") {
+				settings.tileSize = std::stoi(value);
+			}
+			else if (option == "--erode") {
+				settings.droplets = std::stoi(value);
+			}
+			else if (option == "--thermal") {
+				settings.thermalIterations = std::stoi(value);
+			}
+			else if (option == "--threads") {
+				settings.threads = (unsigned)std::stoul(value);
+			}
+			else {
+				std::cout << "UNKNOWN OPTION: " << option << std::endl;
+				printUsage(argv[0]);
+				return false;
+			}
+		}
+		catch (const std::exception&) {
+			std::cout << "INVALID VALUE FOR " << option << ": " << value << std::endl;
+			printUsage(argv[0]);
+			return false;
+		}
+	}
+
+	if (settings.recipe != "fbm" && settings.recipe != "ridged" && settings.recipe != "billow" && settings.recipe != "warped") {
+		std::cout << "UNKNOWN RECIPE: " << settings.recipe << std::endl;
+		return false;
+	}
+	if (settings.size < 2) {
+		std::cout << "INVALID SIZE: " << settings.size << std::endl;
+		return false;
+	}
+	if (settings.octaves < 1 || settings.tileSize <= 0 || settings.droplets < 0 || settings.thermalIterations < 0) {
+		std::cout << "INVALID OCTAVES, TILE SIZE OR EROSION COUNT" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+static void generate(JobSystem& jobs, const BakeSettings& settings, float* heights) {
+	int n = settings.size;
+	FractalParams params;
+	params.octaves = settings.octaves;
+	params.type = settings.recipe == "ridged" ? FRACTAL_RIDGED : settings.recipe == "billow" ? FRACTAL_BILLOW : FRACTAL_FBM;
+	// only a map going straight to R16 may skip the octaves below its step, erosion would amplify the difference
+	if (settings.format == HEIGHT_R16 && settings.droplets == 0 && settings.thermalIterations == 0) {
+		params.quantizeLevels = 65535;
+	}
+
+	PerlinNoise base(settings.seed);
+	FractalNoise fractal(base, params);
+	if (settings.recipe != "warped") {
+		generateHeightmap(jobs, fractal, heights, n, n, glm::vec2(0.0f), settings.scale);
+		return;
+	}
+
+	using namespace noise_graph;
+
+	// fbm plus a domain warped detail layer, terraced and clamped
+	PerlinNoise warpX(settings.seed + 1), warpY(settings.seed + 2);
+	CurveTable terraces = { { 0.0f, 0.0f }, { 0.4f, 0.3f }, { 0.7f, 0.75f }, { 1.0f, 1.0f } };
+	auto recipe = clampNode(curveNode(
+		Fractal(fractal) + warpNode(Perlin(base, 4.0f), Perlin(warpX), Perlin(warpY), 0.5f) * 0.25f,
+		terraces), 0.0f, 1.0f);
+
+	forEachTile(jobs, n, n, DEFAULT_TILE_SIZE, [&](int x0, int y0, int tw, int th) {
+		generateRegion(recipe, heights, n, x0, y0, tw, th, glm::vec2(0.0f), settings.scale);
+	});
+}
+
+// R16 texels of the heights, a row per job
+static Heightmap quantize(JobSystem& jobs, const float* heights, int w, int h) {
+	Heightmap map(w, h, HEIGHT_R16);
+	uint16_t* texels = (uint16_t*)map.data();
+	jobs.parallelFor(h, [&](int y) {
+		quantizeR16(heights + (size_t)y * w, texels + (size_t)y * w, w);
+	});
+	return map;
+}
+
+int main(int argc, char** argv) {
+	BakeSettings settings;
+	if (!parseArguments(argc, argv, settings)) {
+		return -1;
+	}
+
+	Clock::time_point bakeStart = Clock::now();
+	JobSystem jobs(settings.threads);
+	int n = settings.size;
+	std::cout << "baking " << settings.recipe << ", seed " << settings.seed << ", " << n << "x" << n
+		<< (settings.format == HEIGHT_R16 ? " R16" : " R32F") << '\n';
+
+	std::vector<float> heights((size_t)n * n);
+	Clock::time_point start = Clock::now();
+	generate(jobs, settings, heights.data());
+	std::cout << "  generate: " << millisecondsSince(start) << " ms\n";
+
+	if (settings.droplets > 0) {
+		HydraulicParams erosion;
+		erosion.droplets = settings.droplets;
+		erosion.seed = settings.seed;
+		start = Clock::now();
+		erodeHydraulic(jobs, heights.data(), n, n, erosion);
+		std::cout << "  hydraulic erosion: " << millisecondsSince(start) << " ms\n";
+	}
+
+	if (settings.thermalIterations > 0) {
+		ThermalParams thermal;
+		thermal.iterations = settings.thermalIterations;
+		start = Clock::now();
+		erodeThermal(jobs, heights.data(), n, n, thermal);
+		std::cout << "  thermal erosion: " << millisecondsSince(start) << " ms\n";
+	}
+
+	std::vector<unsigned char> normals((size_t)n * n * 3);
+	start = Clock::now();
+	generateNormalMap(jobs, heights.data(), n, n, normals.data());
+	std::cout << "  normal map: " << millisecondsSince(start) << " ms\n";
+
+	start = Clock::now();
+	Heightmap r16 = quantize(jobs, heights.data(), n, n);
+	Heightmap r32;
+	if (settings.format == HEIGHT_R32F) {
+		r32 = Heightmap::fromFloats(heights.data(), n, n, HEIGHT_R32F);
+	}
+	const Heightmap& tiled = settings.format == HEIGHT_R16 ? r16 : r32;
+	std::cout << "  quantize: " << millisecondsSince(start) << " ms\n";
+
+	// the files go out side by side, each on its own job
+	struct Output {
+		std::string path;
+		std::function<bool(const std::string&)> write;
+		double ms = 0.0;
+		bool written = false;
+	};
+	Output outputs[] = {
+		{ settings.prefix + ".hmap", [&](const std::string& path) { return HeightmapFile::write(path, tiled, settings.tileSize); } },
+		{ settings.prefix + "_height.png", [&](const std::string& path) { return writePNG(path, r16.data(), n, n, 1, 16); } },
+		{ settings.prefix + "_normal.png", [&](const std::string& path) { return writePNG(path, normals.data(), n, n, 3, 8); } }
+	};
+
+	start = Clock::now();
+	for (Output& output : outputs) {
+		jobs.submit([&output]() {
+			Clock::time_point writeStart = Clock::now();
+			output.written = output.write(output.path);
+			output.ms = millisecondsSince(writeStart);
+		});
+	}
+	jobs.wait();
+	std::cout << "  write: " << millisecondsSince(start) << " ms\n";
+
+	bool failed = false;
+	for (const Output& output : outputs) {
+		std::cout << "    " << output.path << ": " << output.ms << " ms" << (output.written ? "" : " FAILED") << '\n';
+		failed |= !output.written;
+	}
+
+	std::cout << "  total: " << millisecondsSince(bakeStart) << " ms on " << jobs.threadCount() << " threads" << std::endl;
+	return failed ? -1 : 0;
+}
@@ -0,0 +1,59 @@
+#include "terrain_gen.hpp"
+#include "heightmap.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+void forEachTile(JobSystem& jobs, int w, int h, int tileSize,
+	const std::function<void(int, int, int, int)>& fn)
+{
+	int tilesX = (w + tileSize - 1) / tileSize;
+	int tilesY = (h + tileSize - 1) / tileSize;
+
+	jobs.parallelFor(tilesX * tilesY, [&](int tile) {
+		int x0 = (tile % tilesX) * tileSize;
+		int y0 = (tile / tilesX) * tileSize;
+		fn(x0, y0, std::min(tileSize, w - x0), std::min(tileSize, h - y0));
+	});
+}
+
+void generateHeightmap(JobSystem& jobs, const PerlinNoise& noise, float* out, int w, int h,
+	glm::vec2 origin, float scale, int tileSize)
+{
+	forEachTile(jobs, w, h, tileSize, [&](int x0, int y0, int tw, int th) {
+		noise.generateRegion(out, w, x0, y0, tw, th, origin, scale);
+	});
+}
+
+void generateHeightmap(JobSystem& jobs, const FractalNoise& noise, float* out, int w, int h,
+	glm::vec2 origin, float scale, int tileSize)
+{
+	forEachTile(jobs, w, h, tileSize, [&](int x0, int y0, int tw, int th) {
+		noise.generateRegion(out, w, x0, y0, tw, th, origin, scale);
+	});
+}
+
+static unsigned char encodeUnit(float v) {
+	return (unsigned char)std::lround((v * 0.5f + 0.5f) * 255.0f);
+}
+
+void generateNormalMap(JobSystem& jobs, const float* heights, int w, int h, unsigned char* rgb, int tileSize) {
+	forEachTile(jobs, w, h, tileSize, [&](int x0, int y0, int tw, int th) {
+		for (int y = y0; y < y0 + th; y++) {
+			int up = std::max(0, y - 1), down = std::min(h - 1, y + 1);
+			const float* row = heights + (size_t)y * w;
+			for (int x = x0; x < x0 + tw; x++) {
+				int left = std::max(0, x - 1), right = std::min(w - 1, x + 1);
+				float dx = (row[right] - row[left]) * HEIGHT_SCALE / (float)std::max(1, right - left);
+				float dz = (heights[(size_t)down * w + x] - heights[(size_t)up * w + x]) * HEIGHT_SCALE
+					/ (float)std::max(1, down - up);
+
+				glm::vec3 normal = glm::normalize(glm::vec3(-dx, 1.0f, -dz));
+				unsigned char* out = rgb + ((size_t)y * w + x) * 3;
+				out[0] = encodeUnit(normal.x);
+				out[1] = encodeUnit(normal.z);
+				out[2] = encodeUnit(normal.y);
+			}
+		}
+	});
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <functional>
+
+#include "fractal.hpp"
+#include "job_system.hpp"
+#include "noise.hpp"
+
+// 64x64 floats is 16 KB, a tile and its output rows stay in L1 while it is generated
+static const int DEFAULT_TILE_SIZE = 64;
+
+// calls fn(x0, y0, tileWidth, tileHeight) for every tile covering a w x h grid, spread over the job system
+void forEachTile(JobSystem& jobs, int w, int h, int tileSize,
+	const std::function<void(int, int, int, int)>& fn);
+
+/*
+	Multithreaded PerlinNoise::generate(). out keeps the flat row-major
+	w x h layout handed to glTexImage2D, each job fills one tile of it.
+*/
+void generateHeightmap(JobSystem& jobs, const PerlinNoise& noise, float* out, int w, int h,
+	glm::vec2 origin, float scale, int tileSize = DEFAULT_TILE_SIZE);
+
+void generateHeightmap(JobSystem& jobs, const FractalNoise& noise, float* out, int w, int h,
+	glm::vec2 origin, float scale, int tileSize = DEFAULT_TILE_SIZE);
+
+/*
+	Normal map of a w x h buffer of normalized heights, 3 bytes per texel:
+	the world normal's x and z in R and G and its up component in B, each
+	mapped from [-1, 1] to [0, 255]. Texels are one world unit apart and
+	heights get HEIGHT_SCALE, like the terrain drawn; slopes are central
+	differences, one sided on the map's edges.
+*/
+void generateNormalMap(JobSystem& jobs, const float* heights, int w, int h, unsigned char* rgb,
+	int tileSize = DEFAULT_TILE_SIZE);
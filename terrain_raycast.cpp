@@ -0,0 +1,283 @@
+#include "terrain_raycast.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+static const float INFINITE_DISTANCE = std::numeric_limits<float>::infinity();
+
+// rays handed to one job by the batched raycast
+static const int RAY_BLOCK = 64;
+
+// more levels than any heightmap a 32 bit index can address
+static const int MAX_LEVELS = 32;
+
+static const int LEAF_SHIFT = 2;
+static_assert(HeightPyramid::LEAF_CELLS == 1 << LEAF_SHIFT, "nodes are found by shifting cell coordinates");
+
+// narrows [t0, t1] to where o + d * t lies within [lo, hi] on one axis
+static inline bool clipSlab(float o, float d, float lo, float hi, float& t0, float& t1) {
+	if (d == 0.0f) {
+		return o >= lo && o <= hi;
+	}
+	float ta = (lo - o) / d, tb = (hi - o) / d;
+	if (ta > tb) {
+		std::swap(ta, tb);
+	}
+	t0 = std::max(t0, ta);
+	t1 = std::min(t1, tb);
+	return t0 <= t1;
+}
+
+// cell holding coordinate p, the one ahead along d when p sits on a boundary
+static inline int cellOf(float p, float d, int count) {
+	int cell = d < 0.0f ? (int)std::ceil(p) - 1 : (int)std::floor(p);
+	return std::clamp(cell, 0, count - 1);
+}
+
+TerrainRaycaster::TerrainRaycaster(const Heightmap& map, const HeightPyramid& pyramid, glm::vec2 origin)
+	: m_map(map), m_pyramid(pyramid), m_origin(origin)
+{}
+
+// corners (x, y), (x + 1, y), (x, y + 1), (x + 1, y + 1) of the cell
+static inline bool intersectCell(glm::vec3 origin, glm::vec3 dir, glm::ivec2 cell, const float* h, float t0, float t1,
+	RayHit& hit)
+{
+	float h00 = h[0], h10 = h[1], h01 = h[2], h11 = h[3];
+	float a = h10 - h00, b = h01 - h00, c = h00 - h10 - h01 + h11;
+
+	// relative to where the ray enters the cell, which keeps the coefficients small
+	glm::vec3 p = origin + dir * t0;
+	float u0 = p.x - (float)cell.x, v0 = p.z - (float)cell.y;
+
+	/*
+		Ray height minus surface height along the ray, a quadratic in s
+		since u and v are both linear in s:
+		f(s) = q0 + q1 * s + q2 * s^2
+	*/
+	float q0 = p.y - (h00 + a * u0 + b * v0 + c * u0 * v0);
+	float q1 = dir.y - (a * dir.x + b * dir.z + c * (u0 * dir.z + v0 * dir.x));
+	float q2 = -c * dir.x * dir.z;
+	float length = t1 - t0;
+
+	// the first crossing, from above or from below
+	float s = INFINITE_DISTANCE;
+	if (q0 == 0.0f) {
+		s = 0.0f;
+	}
+	else if (std::fabs(q2) < 1e-12f) {
+		if (q1 != 0.0f && -q0 / q1 >= 0.0f) {
+			s = -q0 / q1;
+		}
+	}
+	else {
+		float discriminant = q1 * q1 - 4.0f * q2 * q0;
+		if (discriminant >= 0.0f) {
+			// the numerically stable pair of roots
+			float q = -0.5f * (q1 + std::copysign(std::sqrt(discriminant), q1));
+			float r0 = q / q2;
+			float r1 = q != 0.0f ? q0 / q : INFINITE_DISTANCE;
+			if (r0 >= 0.0f) {
+				s = std::min(s, r0);
+			}
+			if (r1 >= 0.0f) {
+				s = std::min(s, r1);
+			}
+		}
+	}
+	if (s > length) {
+		return false;
+	}
+
+	float u = u0 + dir.x * s, v = v0 + dir.z * s;
+	hit.hit = true;
+	hit.distance = t0 + s;
+	hit.position = origin + dir * hit.distance;
+	// texels are one world unit apart, the height derivatives are the slopes
+	hit.normal = glm::normalize(glm::vec3(-(a + c * v), 1.0f, -(b + c * u)));
+	return true;
+}
+
+/*
+	Raw views of the pyramid levels and the texels, plus the root's box.
+	Built once per call and shared by every ray of a batch, the loop in
+	castRay() runs for every node a ray visits.
+*/
+struct RaycastScene {
+	struct LevelView {
+		const uint16_t* nodes;
+		int width;
+		int height;
+	};
+	LevelView levels[MAX_LEVELS];
+	int top = -1; // -1 when there is nothing to hit
+	int cellsX = 0, cellsY = 0;
+	float rootLow = 0.0f, rootHigh = 0.0f;
+	int width = 0;
+	const uint16_t* texels16 = nullptr;
+	const float* texels32 = nullptr;
+	glm::vec2 origin = glm::vec2(0.0f);
+
+	RaycastScene(const Heightmap& map, const HeightPyramid& pyramid, glm::vec2 origin) : origin(origin) {
+		if (pyramid.empty() || map.width() < 2 || map.height() < 2) {
+			return;
+		}
+		top = pyramid.levelCount() - 1;
+		for (int l = 0; l <= top; l++) {
+			levels[l] = { pyramid.levelData(l), pyramid.levelWidth(l), pyramid.levelHeight(l) };
+		}
+		cellsX = pyramid.cellsX();
+		cellsY = pyramid.cellsY();
+		glm::vec2 rootRange = pyramid.node(top, 0, 0);
+		rootLow = worldHeight(rootRange.x);
+		rootHigh = worldHeight(rootRange.y);
+		width = map.width();
+		texels16 = map.format() == HEIGHT_R16 ? (const uint16_t*)map.data() : nullptr;
+		texels32 = (const float*)map.data();
+	}
+
+	float texel(int x, int y) const {
+		size_t i = (size_t)y * width + x;
+		return worldHeight(texels16 ? texels16[i] / 65535.0f : texels32[i]);
+	}
+
+	glm::ivec2 nodeOf(int l, glm::ivec2 c) const {
+		int shift = l + LEAF_SHIFT;
+		return glm::ivec2(std::min(c.x >> shift, levels[l].width - 1), std::min(c.y >> shift, levels[l].height - 1));
+	}
+};
+
+static RayHit castRay(const RaycastScene& scene, const Ray& ray) {
+	RayHit hit;
+	float directionLength = glm::length(ray.direction);
+	if (scene.top < 0 || directionLength == 0.0f) {
+		return hit;
+	}
+
+	// texel space, texel (x, y) at (x, height, y)
+	glm::vec3 dir = ray.direction / directionLength;
+	glm::vec3 o = glm::vec3(ray.origin.x - scene.origin.x, ray.origin.y, ray.origin.z - scene.origin.y);
+	int cellsX = scene.cellsX, cellsY = scene.cellsY;
+	int top = scene.top;
+
+	float t0 = 0.0f, t1 = ray.maxDistance;
+	if (!clipSlab(o.x, dir.x, 0.0f, (float)cellsX, t0, t1) ||
+		!clipSlab(o.z, dir.z, 0.0f, (float)cellsY, t0, t1) ||
+		!clipSlab(o.y, dir.y, scene.rootLow, scene.rootHigh, t0, t1))
+	{
+		return hit;
+	}
+
+	glm::ivec2 cell(cellOf(o.x + dir.x * t0, dir.x, cellsX), cellOf(o.z + dir.z * t0, dir.z, cellsY));
+	float t = t0;
+	glm::vec2 invDir = 1.0f / glm::vec2(dir.x, dir.z);
+	// -1 is a single cell
+	int level = top;
+	float corners[4];
+
+	while (true) {
+		glm::ivec4 box;
+		glm::vec2 range;
+		if (level < 0) {
+			box = glm::ivec4(cell, cell + 1);
+			corners[0] = scene.texel(cell.x, cell.y);
+			corners[1] = scene.texel(cell.x + 1, cell.y);
+			corners[2] = scene.texel(cell.x, cell.y + 1);
+			corners[3] = scene.texel(cell.x + 1, cell.y + 1);
+			range = glm::vec2(std::min(std::min(corners[0], corners[1]), std::min(corners[2], corners[3])),
+				std::max(std::max(corners[0], corners[1]), std::max(corners[2], corners[3])));
+		}
+		else {
+			// HeightPyramid::nodeAt() and nodeCells(), the last node of a row or column runs to the edge
+			const RaycastScene::LevelView& view = scene.levels[level];
+			int shift = level + LEAF_SHIFT;
+			int nx = std::min(cell.x >> shift, view.width - 1), ny = std::min(cell.y >> shift, view.height - 1);
+			box = glm::ivec4(nx << shift, ny << shift,
+				nx == view.width - 1 ? cellsX : (nx + 1) << shift,
+				ny == view.height - 1 ? cellsY : (ny + 1) << shift);
+			const uint16_t* node = view.nodes + ((size_t)ny * view.width + nx) * 2;
+			range = glm::vec2(worldHeight(node[0] / 65535.0f), worldHeight(node[1] / 65535.0f));
+		}
+
+		// where the ray leaves the box through its sides
+		float tx = dir.x > 0.0f ? ((float)box.z - o.x) * invDir.x : dir.x < 0.0f ? ((float)box.x - o.x) * invDir.x : INFINITE_DISTANCE;
+		float tz = dir.z > 0.0f ? ((float)box.w - o.z) * invDir.y : dir.z < 0.0f ? ((float)box.y - o.z) * invDir.y : INFINITE_DISTANCE;
+		float tExit = std::min(std::min(tx, tz), t1);
+
+		float ya = o.y + dir.y * t, yb = o.y + dir.y * tExit;
+		if (std::min(ya, yb) <= range.y && std::max(ya, yb) >= range.x) {
+			if (level >= 0) {
+				level--;
+				continue;
+			}
+			if (intersectCell(o, dir, cell, corners, t, tExit, hit)) {
+				hit.position.x += scene.origin.x;
+				hit.position.z += scene.origin.y;
+				return hit;
+			}
+		}
+
+		if (tExit >= t1) {
+			break;
+		}
+
+		// into the neighbour across the side the ray leaves through
+		glm::vec3 p = o + dir * tExit;
+		glm::ivec2 next(std::clamp(cellOf(p.x, dir.x, cellsX), box.x, box.z - 1),
+			std::clamp(cellOf(p.z, dir.z, cellsY), box.y, box.w - 1));
+		if (tx <= tz) {
+			next.x = dir.x > 0.0f ? box.z : box.x - 1;
+		}
+		if (tz <= tx) {
+			next.y = dir.z > 0.0f ? box.w : box.y - 1;
+		}
+		if (next.x < 0 || next.x >= cellsX || next.y < 0 || next.y >= cellsY) {
+			break;
+		}
+
+		/*
+			Up to the coarsest node the step entered: the ones above it still
+			hold the new cell and were already found to overlap the ray.
+		*/
+		while (level < top && scene.nodeOf(level + 1, next) != scene.nodeOf(level + 1, cell)) {
+			level++;
+		}
+
+		cell = next;
+		t = tExit;
+	}
+	return hit;
+}
+
+RayHit TerrainRaycaster::raycast(const Ray& ray) const {
+	return castRay(RaycastScene(m_map, m_pyramid, m_origin), ray);
+}
+
+RayHit TerrainRaycaster::raycast(glm::vec3 origin, glm::vec3 direction) const {
+	Ray ray;
+	ray.origin = origin;
+	ray.direction = direction;
+	return raycast(ray);
+}
+
+void TerrainRaycaster::raycast(const Ray* rays, RayHit* hits, int count) const {
+	RaycastScene scene(m_map, m_pyramid, m_origin);
+	for (int i = 0; i < count; i++) {
+		hits[i] = castRay(scene, rays[i]);
+	}
+}
+
+void TerrainRaycaster::raycast(JobSystem& jobs, const Ray* rays, RayHit* hits, int count) const {
+	int blocks = (count + RAY_BLOCK - 1) / RAY_BLOCK;
+	jobs.parallelFor(blocks, [&](int block) {
+		int first = block * RAY_BLOCK;
+		raycast(rays + first, hits + first, std::min(RAY_BLOCK, count - first));
+	});
+}
+
+bool TerrainRaycaster::lineOfSight(glm::vec3 a, glm::vec3 b) const {
+	Ray ray;
+	ray.origin = a;
+	ray.direction = b - a;
+	ray.maxDistance = glm::length(b - a);
+	return !raycast(ray).hit;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <limits>
+
+#include "height_pyramid.hpp"
+#include "heightmap.hpp"
+#include "job_system.hpp"
+
+struct Ray {
+	glm::vec3 origin = glm::vec3(0.0f);
+	glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f); // any length
+	float maxDistance = std::numeric_limits<float>::infinity();
+};
+
+struct RayHit {
+	bool hit = false;
+	float distance = 0.0f; // world units along the ray
+	glm::vec3 position = glm::vec3(0.0f);
+	glm::vec3 normal = glm::vec3(0.0f, 1.0f, 0.0f);
+};
+
+/*
+	Ray queries against a heightmap on the CPU, for picking and line of
+	sight. The surface is what tess_eval.glsl converges to: texels one world
+	unit apart, bilinear in between, at worldHeight() (height * 64 - 16).
+
+	The ray walks the HeightPyramid top down: it descends into a node only
+	where its height span overlaps the node's and, on leaving a node, climbs
+	to the coarsest node it newly entered, so open air is crossed a whole
+	node at a time. In a cell the bilinear patch along the ray is a
+	quadratic in t, solved exactly for the first crossing. The surface is
+	hit from either side, a ray starting underground hits where it comes up
+	through it.
+
+	The heightmap and pyramid are referenced, not copied, and must outlive
+	the raycaster; rebuild or update() the pyramid when the heightmap
+	changes. Queries are const and safe from any number of threads.
+*/
+class TerrainRaycaster {
+private:
+	const Heightmap& m_map;
+	const HeightPyramid& m_pyramid;
+	glm::vec2 m_origin;
+public:
+	// origin is the world xz of texel (0, 0)
+	TerrainRaycaster(const Heightmap& map, const HeightPyramid& pyramid, glm::vec2 origin = glm::vec2(0.0f));
+
+	RayHit raycast(const Ray& ray) const;
+	RayHit raycast(glm::vec3 origin, glm::vec3 direction) const;
+
+	/*
+		hits[i] for rays[i], one after the other on the calling thread. The
+		rays share the setup of the level views and the root, each one still
+		walks the pyramid on its own: the batch is not faster per ray than
+		raycast(ray) beyond that setup.
+	*/
+	void raycast(const Ray* rays, RayHit* hits, int count) const;
+
+	// the same spread over the job system in blocks of coherent neighbouring rays
+	void raycast(JobSystem& jobs, const Ray* rays, RayHit* hits, int count) const;
+
+	// true when nothing of the terrain lies on the segment between a and b
+	bool lineOfSight(glm::vec3 a, glm::vec3 b) const;
+};
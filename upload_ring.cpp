@@ -0,0 +1,111 @@
+#include "upload_ring.hpp"
+
+#include <iostream>
+
+// keeps every segment's offset suitably aligned for any pixel type
+static const size_t SEGMENT_ALIGNMENT = 256;
+
+UploadRing::UploadRing() {}
+
+UploadRing::~UploadRing() {
+	destroy();
+}
+
+bool UploadRing::create(size_t segmentSize, int segmentCount) {
+	destroy();
+
+	m_segmentSize = (segmentSize + SEGMENT_ALIGNMENT - 1) / SEGMENT_ALIGNMENT * SEGMENT_ALIGNMENT;
+	size_t bytes = m_segmentSize * (size_t)segmentCount;
+
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffers(1, &m_buffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffer);
+	glBufferStorage(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)bytes, NULL, flags);
+	m_mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)bytes, flags);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	if (!m_mapped) {
+		std::cout << "COULD NOT MAP THE UPLOAD RING BUFFER" << std::endl;
+		destroy();
+		return false;
+	}
+
+	m_segments.assign(segmentCount, Segment());
+	m_next = 0;
+	return true;
+}
+
+void UploadRing::destroy() {
+	for (Segment& segment : m_segments) {
+		if (segment.fence) {
+			glDeleteSync(segment.fence);
+		}
+	}
+	m_segments.clear();
+
+	if (m_buffer) {
+		if (m_mapped) {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffer);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		}
+		glDeleteBuffers(1, &m_buffer);
+	}
+	m_buffer = 0;
+	m_mapped = nullptr;
+}
+
+int UploadRing::acquire() {
+	int count = (int)m_segments.size();
+	for (int i = 0; i < count; i++) {
+		int index = (m_next + i) % count;
+		Segment& segment = m_segments[index];
+		if (segment.busy) {
+			continue;
+		}
+
+		if (segment.fence) {
+			// a zero timeout only polls the fence
+			GLenum status = glClientWaitSync(segment.fence, 0, 0);
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+				continue;
+			}
+			glDeleteSync(segment.fence);
+			segment.fence = 0;
+		}
+
+		segment.busy = true;
+		m_next = (index + 1) % count;
+		return index;
+	}
+	return -1;
+}
+
+void* UploadRing::data(int segment) const {
+	return m_mapped + offset(segment);
+}
+
+size_t UploadRing::offset(int segment) const {
+	return (size_t)segment * m_segmentSize;
+}
+
+GLuint UploadRing::buffer() const {
+	return m_buffer;
+}
+
+void UploadRing::submit(int segment) {
+	m_segments[segment].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_segments[segment].busy = false;
+}
+
+void UploadRing::release(int segment) {
+	m_segments[segment].busy = false;
+}
+
+int UploadRing::segmentCount() const {
+	return (int)m_segments.size();
+}
+
+size_t UploadRing::segmentSize() const {
+	return m_segmentSize;
+}
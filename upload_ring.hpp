@@ -0,0 +1,61 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <vector>
+
+/*
+	Ring of equally sized segments in one persistently mapped pixel unpack
+	buffer (GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT).
+
+	A segment is acquired on the render thread, filled by anyone through
+	data() (worker threads write generated heights straight into it) and
+	read by glTexSubImage* calls issued with the buffer bound to
+	GL_PIXEL_UNPACK_BUFFER. submit() fences those calls, and the segment is
+	only handed out again once the fence has signaled, so the CPU never
+	overwrites memory the GPU is still copying from and never waits on it.
+
+	All GL calls happen on the thread owning the context.
+*/
+class UploadRing {
+private:
+	struct Segment {
+		GLsync fence = 0;  // upload still reading the segment
+		bool busy = false; // handed out, not yet submitted or released
+	};
+
+	GLuint m_buffer = 0;
+	unsigned char* m_mapped = nullptr;
+	size_t m_segmentSize = 0;
+	std::vector<Segment> m_segments;
+	int m_next = 0;
+public:
+	UploadRing();
+	~UploadRing();
+
+	UploadRing(const UploadRing&) = delete;
+	UploadRing& operator=(const UploadRing&) = delete;
+
+	// prints the reason and returns false when the buffer cannot be created
+	bool create(size_t segmentSize, int segmentCount);
+	void destroy();
+
+	// a segment the GPU is done with, or -1 when every segment is in use. Never blocks
+	int acquire();
+
+	// the segment's mapped memory, valid from acquire() until submit() or release()
+	void* data(int segment) const;
+
+	// byte offset of the segment, the pixels argument of glTexSubImage* while buffer() is bound
+	size_t offset(int segment) const;
+	GLuint buffer() const;
+
+	// call after the uploads that read the segment
+	void submit(int segment);
+
+	// gives back a segment that was never read by the GPU
+	void release(int segment);
+
+	int segmentCount() const;
+	size_t segmentSize() const;
+};